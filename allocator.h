@@ -0,0 +1,409 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+namespace waitfree
+{
+
+/**
+ * Allocators for the element buffer of the queues.
+ *
+ * An allocator is copyable and provides
+ *     void* allocate(size_t size, size_t alignment);
+ *     void deallocate(void* pointer, size_t size, size_t alignment) noexcept;
+ * allocate returns nullptr on failure, which makes the queue constructor throw std::bad_alloc. size is always a
+ * multiple of alignment and deallocate is called with the same size and alignment as allocate. Queues that need a
+ * zeroed buffer zero it after allocate returns, so pages are first touched by the constructing thread after any
+ * placement policy of the allocator has been applied.
+ *
+ * An allocator whose memory is always zero filled declares
+ *     static constexpr bool zeroed_memory = true;
+ * and the queues skip their own zero fill. The pages of such a buffer are then first touched when used, or by
+ * prefault() on a thread of the caller's choice.
+ */
+
+namespace detail
+{
+
+template<typename Allocator, typename = void>
+struct allocates_zeroed_memory : std::false_type
+{
+};
+
+template<typename Allocator>
+struct allocates_zeroed_memory<Allocator, std::void_t<decltype(Allocator::zeroed_memory)>>
+    : std::bool_constant<Allocator::zeroed_memory>
+{
+};
+
+template<typename Allocator>
+inline constexpr bool allocates_zeroed_memory_v = allocates_zeroed_memory<Allocator>::value;
+
+/**
+ * Zero fills a freshly allocated buffer unless Allocator already returns zeroed memory.
+ */
+template<typename Allocator>
+inline void zero_fill(void* pointer, const size_t size) noexcept
+{
+    if constexpr (!allocates_zeroed_memory_v<Allocator>)
+    {
+        memset(pointer, 0, size);
+    }
+}
+
+/**
+ * Writes one byte per page of [pointer, pointer + size) without changing its contents, so that the calling thread
+ * takes the page faults.
+ */
+inline void prefault(void* pointer, const size_t size) noexcept
+{
+    constexpr size_t page_size = 4096;
+    const auto bytes = reinterpret_cast<volatile uint8_t*>(pointer);
+    for (size_t offset = 0; offset < size; offset += page_size)
+    {
+        bytes[offset] = bytes[offset];
+    }
+}
+
+}// namespace detail
+
+/**
+ * Heap allocation with aligned_alloc, or _aligned_malloc on Windows.
+ */
+struct default_allocator
+{
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+#ifdef _WIN32
+        return _aligned_malloc(size, alignment);
+#else
+        return aligned_alloc(alignment, size);
+#endif
+    }
+
+    void deallocate(void* pointer, size_t, size_t) noexcept
+    {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        free(pointer);
+#endif
+    }
+};
+
+#ifndef _WIN32
+namespace detail
+{
+
+inline size_t round_up_to_page_multiple(const size_t size, const size_t page_size)
+{
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+/**
+ * Maps anonymous memory aligned to alignment, which must be a power of 2. The unaligned head and tail of the
+ * mapping are unmapped again, so the result can be released with munmap(pointer, length).
+ */
+inline void* map_anonymous(const size_t length, const size_t alignment, const int flags)
+{
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (alignment <= page_size)
+    {
+        const auto pointer = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+        return pointer == MAP_FAILED ? nullptr : pointer;
+    }
+
+    const auto mapped_length = length + alignment;
+    const auto pointer = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    if (pointer == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    const auto begin = reinterpret_cast<uintptr_t>(pointer);
+    const auto aligned_begin = (begin + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    if (aligned_begin != begin)
+    {
+        munmap(pointer, aligned_begin - begin);
+    }
+    const auto tail_length = mapped_length - (aligned_begin - begin) - length;
+    if (tail_length != 0)
+    {
+        munmap(reinterpret_cast<void*>(aligned_begin + length), tail_length);
+    }
+    return reinterpret_cast<void*>(aligned_begin);
+}
+
+}// namespace detail
+#endif
+
+/**
+ * Backs the buffer with 2 MB pages to avoid TLB misses on large queues.
+ *
+ * On Linux an explicit MAP_HUGETLB mapping is tried first. If no huge pages are reserved, a 2 MB aligned mapping
+ * with madvise(MADV_HUGEPAGE) is used instead so that transparent huge pages can back it. Other POSIX systems get a
+ * plain 2 MB aligned mapping. Windows falls back to default_allocator, large pages there require the
+ * SeLockMemoryPrivilege.
+ */
+struct huge_page_allocator
+{
+    static constexpr size_t huge_page_size_ = 2 * 1024 * 1024;
+#ifdef _WIN32
+    static constexpr bool zeroed_memory = false;
+#else
+    static constexpr bool zeroed_memory = true;
+#endif
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+#ifdef _WIN32
+        return default_allocator().allocate(size, alignment);
+#else
+        const auto length = detail::round_up_to_page_multiple(size, huge_page_size_);
+#ifdef MAP_HUGETLB
+        if (alignment <= huge_page_size_)
+        {
+            // Huge page mappings are always aligned to the huge page size.
+            if (auto pointer = detail::map_anonymous(length, 1, MAP_HUGETLB))
+            {
+                return pointer;
+            }
+        }
+#endif
+        const auto pointer = detail::map_anonymous(length, alignment > huge_page_size_ ? alignment : huge_page_size_, 0);
+#ifdef MADV_HUGEPAGE
+        if (pointer)
+        {
+            madvise(pointer, length, MADV_HUGEPAGE);
+        }
+#endif
+        return pointer;
+#endif
+    }
+
+    void deallocate(void* pointer, const size_t size, [[maybe_unused]] const size_t alignment) noexcept
+    {
+#ifdef _WIN32
+        default_allocator().deallocate(pointer, size, alignment);
+#else
+        munmap(pointer, detail::round_up_to_page_multiple(size, huge_page_size_));
+#endif
+    }
+};
+
+/**
+ * Maps the buffer as anonymous memory, which the operating system hands out zero filled, so queues skip their own
+ * zero fill and construction does not touch the pages.
+ *
+ * Pages are then faulted in by the first thread that uses them, or by calling prefault() on the queue from a thread
+ * of the caller's choice. With populate set the pages are faulted in by the mapping, with MAP_POPULATE on Linux and
+ * by touching them on other POSIX systems. Windows falls back to default_allocator and zero fills the buffer.
+ */
+struct mmap_allocator
+{
+    static constexpr bool zeroed_memory = true;
+
+    explicit mmap_allocator(const bool populate = false)
+        : populate_(populate)
+    {
+    }
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+#ifdef _WIN32
+        const auto pointer = default_allocator().allocate(size, alignment);
+        if (pointer)
+        {
+            memset(pointer, 0, size);
+        }
+        return pointer;
+#else
+        const auto length = detail::round_up_to_page_multiple(size, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+#ifdef MAP_POPULATE
+        return detail::map_anonymous(length, alignment, populate_ ? MAP_POPULATE : 0);
+#else
+        const auto pointer = detail::map_anonymous(length, alignment, 0);
+        if (pointer && populate_)
+        {
+            detail::prefault(pointer, length);
+        }
+        return pointer;
+#endif
+#endif
+    }
+
+    void deallocate(void* pointer, const size_t size, [[maybe_unused]] const size_t alignment) noexcept
+    {
+#ifdef _WIN32
+        default_allocator().deallocate(pointer, size, alignment);
+#else
+        munmap(pointer, detail::round_up_to_page_multiple(size, static_cast<size_t>(sysconf(_SC_PAGESIZE))));
+#endif
+    }
+
+    bool populate_;
+};
+
+/**
+ * Binds the buffer to a NUMA node, typically the node of the consumer thread.
+ *
+ * The memory is mapped and bound with mbind(MPOL_BIND) before the queue first touches it, so every page is
+ * allocated on node_. allocate fails if the binding fails. Only Linux supports binding, other systems fall back to
+ * default_allocator and node_ is ignored.
+ */
+struct numa_allocator
+{
+#ifdef __linux__
+    static constexpr bool zeroed_memory = true;
+#else
+    static constexpr bool zeroed_memory = false;
+#endif
+
+    explicit numa_allocator(const int node)
+        : node_(node)
+    {
+    }
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+#ifdef __linux__
+        constexpr size_t bits_per_word = sizeof(unsigned long) * 8;
+        unsigned long node_mask[1024 / bits_per_word] = {};
+        if (node_ < 0 || static_cast<size_t>(node_) >= sizeof(node_mask) * 8)
+        {
+            return nullptr;
+        }
+        node_mask[node_ / bits_per_word] |= 1UL << (node_ % bits_per_word);
+
+        const auto length = detail::round_up_to_page_multiple(size, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        const auto pointer = detail::map_anonymous(length, alignment, 0);
+        if (!pointer)
+        {
+            return nullptr;
+        }
+        if (syscall(SYS_mbind, pointer, length, MPOL_BIND, node_mask, sizeof(node_mask) * 8, 0) != 0)
+        {
+            munmap(pointer, length);
+            return nullptr;
+        }
+        return pointer;
+#else
+        return default_allocator().allocate(size, alignment);
+#endif
+    }
+
+    void deallocate(void* pointer, const size_t size, [[maybe_unused]] const size_t alignment) noexcept
+    {
+#ifdef __linux__
+        munmap(pointer, detail::round_up_to_page_multiple(size, static_cast<size_t>(sysconf(_SC_PAGESIZE))));
+#else
+        default_allocator().deallocate(pointer, size, alignment);
+#endif
+    }
+
+    int node_;
+};
+
+/**
+ * Caller owned memory region that queue buffers are carved out of.
+ *
+ * Allocation bumps an offset and is thread safe, memory is never returned to the arena. The region must outlive
+ * all queues allocated from it.
+ */
+class memory_arena
+{
+public:
+    memory_arena(void* buffer, const size_t size)
+        : begin_(reinterpret_cast<uintptr_t>(buffer)),
+          size_(size),
+          offset_(0)
+    {
+    }
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+        auto offset = offset_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto aligned_begin = (begin_ + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+            const auto end = aligned_begin + size - begin_;
+            if (end > size_)
+            {
+                return nullptr;
+            }
+            if (offset_.compare_exchange_weak(offset, end, std::memory_order_relaxed))
+            {
+                return reinterpret_cast<void*>(aligned_begin);
+            }
+        }
+    }
+
+private:
+    uintptr_t begin_;
+    size_t size_;
+    std::atomic<size_t> offset_;
+};
+
+/**
+ * Allocates from a memory_arena. Deallocation is a no-op.
+ */
+struct arena_allocator
+{
+    explicit arena_allocator(memory_arena& arena)
+        : arena_(&arena)
+    {
+    }
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+        return arena_->allocate(size, alignment);
+    }
+
+    void deallocate(void*, size_t, size_t) noexcept
+    {
+    }
+
+    memory_arena* arena_;
+};
+
+}// namespace waitfree
@@ -0,0 +1,319 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "async_queue.h requires C++20 coroutines, the queues themselves only need C++17"
+#endif
+
+#include "cache_line.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace waitfree
+{
+
+namespace detail
+{
+
+/**
+ * A consumer coroutine suspended on an empty queue. wake_ is called by the producer that takes it from the wait
+ * strategy.
+ */
+struct async_waiter
+{
+    void (*wake_)(async_waiter*) noexcept;
+};
+
+}// namespace detail
+
+/**
+ * Wait strategy that lets a consumer coroutine suspend on an empty queue with async_pop().
+ *
+ * The waiting coroutine is registered in a single atomic slot. notify() costs a full memory fence and a load of the
+ * slot, which is only written when the consumer suspends, and hands the coroutine to its scheduler when the slot is
+ * set, so producers never make a system call themselves. pop_wait() spins and yields like yield_wait.
+ */
+template<size_t Spins = 1024>
+class coroutine_wait
+{
+public:
+    void notify() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiter_.load(std::memory_order_relaxed) == nullptr)
+        {
+            return;
+        }
+
+        if (auto waiter = waiter_.exchange(nullptr, std::memory_order_acquire))
+        {
+            waiter->wake_(waiter);
+        }
+    }
+
+    template<typename Ready>
+    bool wait_until(Ready&& ready, const std::chrono::steady_clock::time_point deadline) noexcept
+    {
+        return yield_wait<Spins>().wait_until(std::forward<Ready>(ready), deadline);
+    }
+
+    /**
+     * @brief Registers the consumer's waiter, used by async_pop().
+     *
+     * @details
+     * The caller must check the queue again after arming, and take the waiter back with disarm() if an item arrived.
+   */
+    void arm(detail::async_waiter* waiter) noexcept
+    {
+        // Release, the producer that takes the waiter reads it.
+        waiter_.store(waiter, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief Takes the waiter back, used by async_pop().
+     *
+     * @details
+     * Returns false if a producer took it first, the waiter is then woken by that producer.
+   */
+    bool disarm(detail::async_waiter* waiter) noexcept
+    {
+        return waiter_.compare_exchange_strong(waiter, nullptr, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+private:
+    alignas(cache_line_size) std::atomic<detail::async_waiter*> waiter_{nullptr};
+};
+
+/**
+ * Schedule for async_pop() that resumes the consumer inline, on the thread of the producer that woke it.
+ */
+struct resume_inline
+{
+    void operator()(const std::coroutine_handle<> handle) const
+    {
+        handle.resume();
+    }
+};
+
+/**
+ * Result of async_pop(), a lazily started task that completes with the popped item. Awaited once.
+ */
+template<typename T>
+class [[nodiscard]] async_pop_task
+{
+public:
+    struct promise_type
+    {
+        std::optional<T> value_;
+        std::coroutine_handle<> continuation_;
+
+        async_pop_task get_return_object() noexcept
+        {
+            return async_pop_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct final_awaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(const std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    return handle.promise().continuation_;
+                }
+
+                void await_resume() noexcept
+                {
+                }
+            };
+            return final_awaiter{};
+        }
+
+        void return_value(T value)
+        {
+            value_.emplace(std::move(value));
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    async_pop_task(async_pop_task&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    async_pop_task(const async_pop_task&) = delete;
+    async_pop_task& operator=(const async_pop_task&) = delete;
+    async_pop_task& operator=(async_pop_task&&) = delete;
+
+    ~async_pop_task()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(const std::coroutine_handle<> continuation) noexcept
+    {
+        handle_.promise().continuation_ = continuation;
+        return handle_;
+    }
+
+    T await_resume()
+    {
+        return std::move(*handle_.promise().value_);
+    }
+
+private:
+    explicit async_pop_task(const std::coroutine_handle<promise_type> handle) noexcept
+        : handle_(handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail
+{
+
+/**
+ * Suspends the consumer until the queue has an item at its head, or resumes it right away if it already has one.
+ */
+template<typename Queue, typename Schedule>
+class queue_ready_awaiter : private async_waiter
+{
+public:
+    queue_ready_awaiter(Queue& queue, const Schedule& schedule) noexcept
+        : async_waiter{&wake},
+          queue_(queue),
+          schedule_(schedule)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return queue_.front() != nullptr;
+    }
+
+    bool await_suspend(const std::coroutine_handle<> handle) noexcept
+    {
+        // A producer may take the waiter as soon as it is armed, but only schedules the coroutine once suspended_
+        // is set. Until then the consumer still owns the queue and the awaiter.
+        handle_ = handle;
+        auto& waiter = queue_.wait_strategy();
+        waiter.arm(this);
+        if (queue_.front() != nullptr && waiter.disarm(this))
+        {
+            return false;
+        }
+        // Keep running if a producer already tried to wake the coroutine, otherwise that producer schedules it.
+        return state_.exchange(suspended_, std::memory_order_acq_rel) != woken_;
+    }
+
+    void await_resume() noexcept
+    {
+    }
+
+private:
+    static constexpr uint32_t woken_ = 1;
+    static constexpr uint32_t suspended_ = 2;
+
+    Queue& queue_;
+    Schedule schedule_;
+    std::coroutine_handle<> handle_;
+    std::atomic<uint32_t> state_{0};
+
+    static void wake(async_waiter* waiter) noexcept
+    {
+        auto& self = *static_cast<queue_ready_awaiter*>(waiter);
+        if (self.state_.exchange(woken_, std::memory_order_acq_rel) != suspended_)
+        {
+            return;
+        }
+        // The awaiter is gone as soon as the consumer resumes, copy what is needed first.
+        auto schedule = self.schedule_;
+        const auto handle = self.handle_;
+        schedule(handle);
+    }
+};
+
+}// namespace detail
+
+/**
+ * @brief Pops an item from queue, suspending the calling coroutine while the queue is empty.
+ *
+ * @details
+ * T item = co_await async_pop(queue, schedule);
+ * The queue must use coroutine_wait as its wait strategy. When an item is pushed to the empty queue the producer
+ * passes the suspended coroutine handle to schedule, which should resume it on the consumer's executor. schedule is
+ * called on the producer's thread, must not throw and is copied, so it should be cheap to copy, such as a pointer to
+ * the executor. The default, resume_inline, resumes the consumer on the producer's thread.
+ * A wakeup is not a promise of an item, the task checks the queue again and suspends again if it has none, so an
+ * item reserved but not yet published by an mpsc_queue producer never blocks the executor.
+ *
+ * Not thread safe with regards to other pop operations, thread safe with regards to push operations. Only one
+ * async_pop() may be pending per queue.
+ */
+template<typename Queue, typename Schedule = resume_inline>
+async_pop_task<typename Queue::value_type> async_pop(Queue& queue, Schedule schedule = Schedule())
+{
+    typename Queue::value_type item;
+    while (!queue.pop(item))
+    {
+        co_await detail::queue_ready_awaiter<Queue, Schedule>(queue, schedule);
+    }
+    co_return std::move(item);
+}
+
+}// namespace waitfree
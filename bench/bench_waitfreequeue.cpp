@@ -0,0 +1,538 @@
+#include "mpmc_queue.h"
+#include "mpsc_queue.h"
+#include "segmented_mpsc_queue.h"
+#include "spsc_queue.h"
+#include "spsc_queue_fast.h"
+#include "wait_strategy.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+enum class output_format
+{
+    text,
+    csv,
+    json
+};
+
+struct options
+{
+    output_format format_ = output_format::text;
+    std::vector<int> cores_;
+    std::vector<size_t> producers_ = {1, 2, 4};
+    std::string queue_filter_;
+    size_t messages_ = size_t(1) << 20;
+    size_t round_trips_ = 100000;
+};
+
+/**
+ * Log-linear latency histogram in the style of HdrHistogram. Values are bucketed by their highest set bit and then
+ * linearly into 2^precision_bits_ sub-buckets, which keeps the relative error below 1% over the whole range.
+ */
+class latency_histogram
+{
+public:
+    void record(const uint64_t value) noexcept
+    {
+        ++counts_[index_of(value)];
+        ++count_;
+        max_ = std::max(max_, value);
+    }
+
+    [[nodiscard]] uint64_t percentile(const double percentile) const noexcept
+    {
+        if (count_ == 0)
+        {
+            return 0;
+        }
+
+        const auto target = static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count_)));
+        uint64_t seen = 0;
+        for (size_t index = 0; index < bucket_count_; ++index)
+        {
+            seen += counts_[index];
+            if (seen >= std::max<uint64_t>(target, 1))
+            {
+                return std::min(highest_value_of(index), max_);
+            }
+        }
+        return max_;
+    }
+
+    [[nodiscard]] uint64_t max() const noexcept
+    {
+        return max_;
+    }
+
+private:
+    static constexpr unsigned precision_bits_ = 7;
+    static constexpr size_t sub_bucket_count_ = size_t(1) << precision_bits_;
+    static constexpr size_t bucket_count_ = (64 - precision_bits_ + 1) * sub_bucket_count_;
+
+    std::vector<uint64_t> counts_ = std::vector<uint64_t>(bucket_count_, 0);
+    uint64_t count_ = 0;
+    uint64_t max_ = 0;
+
+    static unsigned highest_bit(const uint64_t value) noexcept
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    static size_t index_of(const uint64_t value) noexcept
+    {
+        if (value < sub_bucket_count_)
+        {
+            return static_cast<size_t>(value);
+        }
+        const auto magnitude = highest_bit(value) - precision_bits_ + 1;
+        const auto sub_bucket = static_cast<size_t>(value >> magnitude) - sub_bucket_count_ / 2;
+        return magnitude * (sub_bucket_count_ / 2) + sub_bucket_count_ / 2 + sub_bucket;
+    }
+
+    static uint64_t highest_value_of(const size_t index) noexcept
+    {
+        if (index < sub_bucket_count_)
+        {
+            return index;
+        }
+        const auto magnitude = (index - sub_bucket_count_ / 2) / (sub_bucket_count_ / 2);
+        const auto sub_bucket = (index - sub_bucket_count_ / 2) % (sub_bucket_count_ / 2) + sub_bucket_count_ / 2;
+        return ((static_cast<uint64_t>(sub_bucket) + 1) << magnitude) - 1;
+    }
+};
+
+struct result
+{
+    std::string queue_;
+    std::string benchmark_;
+    size_t producers_;
+    size_t element_size_;
+    size_t capacity_;
+    double operations_per_second_;
+    uint64_t p50_;
+    uint64_t p99_;
+    uint64_t p999_;
+    uint64_t max_;
+};
+
+/**
+ * Pins the calling thread to the core at position index of the --pin list, if one was given.
+ */
+void pin_current_thread(const options& options, const size_t index)
+{
+    if (options.cores_.empty())
+    {
+        return;
+    }
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(options.cores_[index % options.cores_.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)index;
+#endif
+}
+
+template<size_t N>
+struct message
+{
+    static_assert(N > 16);
+
+    uint64_t sequence_;
+    int64_t timestamp_;
+    uint8_t padding_[N - 16];
+};
+
+// Without the padding member, a zero size array is not valid C++.
+template<>
+struct message<16>
+{
+    uint64_t sequence_;
+    int64_t timestamp_;
+};
+
+int64_t now_ns() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void backoff(uint32_t& spins) noexcept
+{
+    if (++spins < 64)
+    {
+        waitfree::detail::cpu_relax();
+    }
+    else
+    {
+        std::this_thread::yield();
+    }
+}
+
+template<typename Queue, typename = void>
+struct has_try_push : std::false_type
+{
+};
+
+template<typename Queue>
+struct has_try_push<Queue, std::void_t<decltype(std::declval<Queue&>().try_push(std::declval<int>()))>> : std::true_type
+{
+};
+
+template<typename Queue, typename T>
+void push_blocking(Queue& queue, const T& item) noexcept
+{
+    if constexpr (has_try_push<Queue>::value)
+    {
+        for (uint32_t spins = 0; !queue.try_push(item);)
+        {
+            backoff(spins);
+        }
+    }
+    else
+    {
+        queue.push(item);
+    }
+}
+
+template<typename Queue, typename T>
+void pop_blocking(Queue& queue, T& item) noexcept
+{
+    for (uint32_t spins = 0; !queue.pop(item);)
+    {
+        backoff(spins);
+    }
+}
+
+template<typename T, size_t S>
+using mpsc = waitfree::mpsc_queue<T, S>;
+template<typename T, size_t S>
+using mpmc = waitfree::mpmc_queue<T, S>;
+template<typename T, size_t S>
+using segmented_mpsc = waitfree::segmented_mpsc_queue<T, S>;
+template<typename T, size_t S>
+using spsc = waitfree::spsc_queue<T, S>;
+template<typename T, size_t S>
+using spsc_fast = waitfree::spsc_queue_fast<T, S>;
+
+/**
+ * producers threads push options.messages_ items each, one consumer pops them all.
+ */
+template<template<typename, size_t> class Queue, size_t N, size_t S>
+result run_throughput(const char* name, const size_t producers, const options& options)
+{
+    using item_type = message<N>;
+    auto queue = std::make_unique<Queue<item_type, S>>();
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> threads;
+    for (size_t producer = 0; producer < producers; ++producer)
+    {
+        threads.emplace_back([&, producer]() {
+            pin_current_thread(options, producer + 1);
+            item_type item{};
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < options.messages_; ++i)
+            {
+                item.sequence_ = (static_cast<uint64_t>(producer) << 48) | i;
+                push_blocking(*queue, item);
+            }
+        });
+    }
+
+    pin_current_thread(options, 0);
+    while (ready.load() != producers)
+    {
+        std::this_thread::yield();
+    }
+
+    const auto total = options.messages_ * producers;
+    const auto start = now_ns();
+    go.store(true, std::memory_order_release);
+    item_type item;
+    for (size_t i = 0; i < total; ++i)
+    {
+        pop_blocking(*queue, item);
+    }
+    const auto elapsed = now_ns() - start;
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    return {name, "throughput", producers, N, S, static_cast<double>(total) * 1e9 / static_cast<double>(elapsed), 0, 0, 0, 0};
+}
+
+/**
+ * Each producer sends a timestamped item through the queue under test to an echo thread, which returns it on a per
+ * producer spsc_queue_fast. The histogram holds the round trip time in nanoseconds of every item.
+ */
+template<template<typename, size_t> class Queue, size_t N, size_t S>
+result run_round_trip(const char* name, const size_t producers, const options& options)
+{
+    using item_type = message<N>;
+    auto requests = std::make_unique<Queue<item_type, S>>();
+    std::vector<std::unique_ptr<waitfree::spsc_queue_fast<item_type, S>>> responses;
+    for (size_t producer = 0; producer < producers; ++producer)
+    {
+        responses.emplace_back(std::make_unique<waitfree::spsc_queue_fast<item_type, S>>());
+    }
+
+    const auto total = options.round_trips_ * producers;
+    std::thread echo([&]() {
+        pin_current_thread(options, 0);
+        item_type item;
+        for (size_t i = 0; i < total; ++i)
+        {
+            pop_blocking(*requests, item);
+            push_blocking(*responses[item.sequence_ >> 48], item);
+        }
+    });
+
+    std::vector<latency_histogram> histograms(producers);
+    std::vector<std::thread> threads;
+    const auto start = now_ns();
+    for (size_t producer = 0; producer < producers; ++producer)
+    {
+        threads.emplace_back([&, producer]() {
+            pin_current_thread(options, producer + 1);
+            item_type item{};
+            for (size_t i = 0; i < options.round_trips_; ++i)
+            {
+                item.sequence_ = (static_cast<uint64_t>(producer) << 48) | i;
+                item.timestamp_ = now_ns();
+                push_blocking(*requests, item);
+                pop_blocking(*responses[producer], item);
+                histograms[producer].record(static_cast<uint64_t>(now_ns() - item.timestamp_));
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    const auto elapsed = now_ns() - start;
+    echo.join();
+
+    // Percentiles over all producers, from the histogram of the slowest producer at each percentile.
+    uint64_t p50 = 0, p99 = 0, p999 = 0, max = 0;
+    for (const auto& histogram : histograms)
+    {
+        p50 = std::max(p50, histogram.percentile(50.0));
+        p99 = std::max(p99, histogram.percentile(99.0));
+        p999 = std::max(p999, histogram.percentile(99.9));
+        max = std::max(max, histogram.max());
+    }
+    return {name, "round_trip", producers, N, S, static_cast<double>(total) * 1e9 / static_cast<double>(elapsed), p50, p99, p999, max};
+}
+
+template<template<typename, size_t> class Queue, size_t N, size_t S>
+void run_queue(const char* name, const bool multi_producer, const options& options, std::vector<result>& results)
+{
+    if (!options.queue_filter_.empty() && options.queue_filter_ != name)
+    {
+        return;
+    }
+
+    for (const auto producers : options.producers_)
+    {
+        if (producers != 1 && !multi_producer)
+        {
+            continue;
+        }
+        results.push_back(run_throughput<Queue, N, S>(name, producers, options));
+        results.push_back(run_round_trip<Queue, N, S>(name, producers, options));
+    }
+}
+
+template<size_t N, size_t S>
+void run_all(const options& options, std::vector<result>& results)
+{
+    run_queue<mpsc, N, S>("mpsc_queue", true, options, results);
+    run_queue<mpmc, N, S>("mpmc_queue", true, options, results);
+    run_queue<segmented_mpsc, N, S>("segmented_mpsc_queue", true, options, results);
+    run_queue<spsc, N, S>("spsc_queue", false, options, results);
+    run_queue<spsc_fast, N, S>("spsc_queue_fast", false, options, results);
+}
+
+void print(const std::vector<result>& results, const output_format format)
+{
+    switch (format)
+    {
+        case output_format::text:
+            printf("%-22s %-11s %9s %12s %9s %14s %9s %9s %9s %9s\n", "queue", "benchmark", "producers", "element_size", "capacity",
+                   "ops_per_sec", "p50_ns", "p99_ns", "p999_ns", "max_ns");
+            for (const auto& r : results)
+            {
+                printf("%-22s %-11s %9zu %12zu %9zu %14.0f %9llu %9llu %9llu %9llu\n", r.queue_.c_str(), r.benchmark_.c_str(), r.producers_,
+                       r.element_size_, r.capacity_, r.operations_per_second_, static_cast<unsigned long long>(r.p50_),
+                       static_cast<unsigned long long>(r.p99_), static_cast<unsigned long long>(r.p999_),
+                       static_cast<unsigned long long>(r.max_));
+            }
+            break;
+        case output_format::csv:
+            printf("queue,benchmark,producers,element_size,capacity,ops_per_sec,p50_ns,p99_ns,p999_ns,max_ns\n");
+            for (const auto& r : results)
+            {
+                printf("%s,%s,%zu,%zu,%zu,%.0f,%llu,%llu,%llu,%llu\n", r.queue_.c_str(), r.benchmark_.c_str(), r.producers_, r.element_size_,
+                       r.capacity_, r.operations_per_second_, static_cast<unsigned long long>(r.p50_),
+                       static_cast<unsigned long long>(r.p99_), static_cast<unsigned long long>(r.p999_),
+                       static_cast<unsigned long long>(r.max_));
+            }
+            break;
+        case output_format::json:
+            printf("[\n");
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const auto& r = results[i];
+                printf("  {\"queue\": \"%s\", \"benchmark\": \"%s\", \"producers\": %zu, \"element_size\": %zu, \"capacity\": %zu, "
+                       "\"ops_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+                       r.queue_.c_str(), r.benchmark_.c_str(), r.producers_, r.element_size_, r.capacity_, r.operations_per_second_,
+                       static_cast<unsigned long long>(r.p50_), static_cast<unsigned long long>(r.p99_),
+                       static_cast<unsigned long long>(r.p999_), static_cast<unsigned long long>(r.max_),
+                       i + 1 == results.size() ? "" : ",");
+            }
+            printf("]\n");
+            break;
+    }
+}
+
+std::vector<size_t> parse_list(const char* text)
+{
+    std::vector<size_t> values;
+    for (const char* cursor = text; *cursor != '\0';)
+    {
+        char* end;
+        const auto value = strtoull(cursor, &end, 10);
+        if (end == cursor)
+        {
+            break;
+        }
+        values.push_back(value);
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+void print_usage()
+{
+    printf("usage: bench_waitfreequeue [options]\n"
+           "  --format=text|csv|json  output format, default text\n"
+           "  --pin=0,2,4             cores to pin to, the consumer takes the first and producers the following ones\n"
+           "  --producers=1,2,4       producer counts to run, single producer queues only run with 1\n"
+           "  --queue=name            only run the named queue, e.g. mpsc_queue\n"
+           "  --messages=n            items per producer in the throughput benchmark\n"
+           "  --round_trips=n         round trips per producer in the latency benchmark\n");
+}
+
+bool parse_options(const int argc, char** argv, options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const auto argument = argv[i];
+        const auto value = strchr(argument, '=');
+        const auto key = value ? std::string(argument, value) : std::string(argument);
+        if (key == "--format" && value)
+        {
+            const std::string format = value + 1;
+            if (format == "text")
+            {
+                options.format_ = output_format::text;
+            }
+            else if (format == "csv")
+            {
+                options.format_ = output_format::csv;
+            }
+            else if (format == "json")
+            {
+                options.format_ = output_format::json;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (key == "--pin" && value)
+        {
+            for (const auto core : parse_list(value + 1))
+            {
+                options.cores_.push_back(static_cast<int>(core));
+            }
+        }
+        else if (key == "--producers" && value)
+        {
+            options.producers_ = parse_list(value + 1);
+        }
+        else if (key == "--queue" && value)
+        {
+            options.queue_filter_ = value + 1;
+        }
+        else if (key == "--messages" && value)
+        {
+            options.messages_ = strtoull(value + 1, nullptr, 10);
+        }
+        else if (key == "--round_trips" && value)
+        {
+            options.round_trips_ = strtoull(value + 1, nullptr, 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+}// namespace
+
+int main(int argc, char** argv)
+{
+    options options;
+    if (!parse_options(argc, argv, options))
+    {
+        print_usage();
+        return 1;
+    }
+
+    std::vector<result> results;
+    run_all<16, 1024>(options, results);
+    run_all<16, 65536>(options, results);
+    run_all<64, 1024>(options, results);
+    run_all<64, 65536>(options, results);
+    run_all<256, 4096>(options, results);
+    print(results, options.format_);
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "allocator.h"
+#include "cache_line.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace waitfree
+{
+
+/**
+ * Wait-free, single producer, multiple reader broadcast ring.
+ *
+ * Every item pushed is seen by each of the R readers, in order. The producer owns tail_ and each reader owns its own
+ * head on its own cache line. Readers access items in place, an item is only destroyed when the producer reuses its
+ * slot after the slowest reader released it. The producer caches the position of the slowest reader and only scans
+ * the reader heads again when the cached view says the ring is full.
+ *
+ * T is the type of the elements in the ring.
+ * S is the maximum number of elements in the ring. S must be a power of 2.
+ * R is the number of readers, each identified by an index in [0, R).
+ * Allocator allocates the element buffer, see allocator.h.
+ */
+template<typename T, size_t S, size_t R, typename Allocator = default_allocator>
+class broadcast_queue
+{
+public:
+    broadcast_queue()
+        : broadcast_queue(Allocator())
+    {
+    }
+
+    /**
+     * Constructs a ring that allocates its buffer from allocator.
+     */
+    explicit broadcast_queue(const Allocator& allocator)
+        : allocator_(allocator),
+          tail_(0),
+          cached_min_head_(0)
+    {
+        static_assert(is_power_of_two(S) && S != 0);
+        static_assert(R != 0);
+
+        auto alloc_result = allocator_.allocate(allocation_size_, alignment_);
+        if (!alloc_result)
+        {
+            throw std::bad_alloc();
+        }
+        elements_ = reinterpret_cast<T*>(alloc_result);
+        for (auto& reader : readers_)
+        {
+            reader.head_.store(0, std::memory_order_relaxed);
+            reader.cached_tail_ = 0;
+        }
+    }
+
+    broadcast_queue(const broadcast_queue&) = delete;
+    broadcast_queue& operator=(const broadcast_queue&) = delete;
+
+    ~broadcast_queue()
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            const auto tail = tail_.load(std::memory_order_acquire);
+            for (auto i = tail - std::min(tail, S); i != tail; ++i)
+            {
+                (&elements_[i & mod_value_])->~T();
+            }
+        }
+        allocator_.deallocate(elements_, allocation_size_, alignment_);
+    }
+
+    /**
+     * @brief Pushes an item to the ring, to be seen by all readers.
+     *
+     * @details
+     * Will assert if the ring is full if asserts are enabled,
+     * otherwise the behaviour is undefined. The ring should be dimensioned so that this never happens.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to reader operations.
+   */
+    template<typename... U>
+    void push(U&&... item) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        assert(!is_full(tail));
+        emplace(tail, std::forward<U>(item)...);
+    }
+
+    /**
+     * @brief Tries to push an item to the ring.
+     *
+     * @details
+     * Returns false without modifying the ring if the slowest reader is S items behind, otherwise pushes the item and
+     * returns true.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to reader operations.
+   */
+    template<typename... U>
+    bool try_push(U&&... item) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (is_full(tail))
+        {
+            return false;
+        }
+        emplace(tail, std::forward<U>(item)...);
+        return true;
+    }
+
+    /**
+     * @brief Returns a pointer to the next item for reader, without copying it.
+     *
+     * @details
+     * Returns nullptr if reader has seen all items. The item stays valid until reader calls release().
+     *
+     * Not thread safe with regards to other operations of the same reader, thread safe with regards to push
+     * operations and to operations of other readers.
+   */
+    [[nodiscard]] const T* front(const size_t reader) noexcept
+    {
+        auto& state = readers_[reader];
+        const auto head = state.head_.load(std::memory_order_relaxed);
+        if (!available(state, head))
+        {
+            return nullptr;
+        }
+        return &elements_[head & mod_value_];
+    }
+
+    /**
+     * @brief Moves reader past the item returned by front().
+     *
+     * @details
+     * Must only be called after front() returned a non null pointer for reader, which is invalidated by the call.
+     *
+     * Not thread safe with regards to other operations of the same reader, thread safe with regards to push
+     * operations and to operations of other readers.
+   */
+    void release(const size_t reader) noexcept
+    {
+        auto& state = readers_[reader];
+        const auto head = state.head_.load(std::memory_order_relaxed);
+        assert(head != state.cached_tail_);
+        state.head_.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies the next item for reader and moves reader past it.
+     *
+     * @details
+     * Returns false if reader has seen all items, otherwise true. item is only valid if the function returns true.
+     *
+     * Not thread safe with regards to other operations of the same reader, thread safe with regards to push
+     * operations and to operations of other readers.
+   */
+    bool pop(const size_t reader, T& item) noexcept
+    {
+        const auto value = front(reader);
+        if (!value)
+        {
+            return false;
+        }
+        item = *value;
+        release(reader);
+        return true;
+    }
+
+    /**
+     * @brief Get the number of items reader has not seen yet.
+     *
+     * @details
+     * The result is a snapshot when the ring is concurrently modified.
+   */
+    [[nodiscard]] size_t size(const size_t reader) const noexcept
+    {
+        const auto head = readers_[reader].head_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        return std::min(tail - head, S);
+    }
+
+    /**
+     * @brief Get the maximum number of elements in the ring.
+   */
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+    /**
+     * @brief Get the number of readers.
+   */
+    [[nodiscard]] static constexpr size_t reader_count() noexcept
+    {
+        return R;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+    static constexpr size_t mod_value_ = S - 1;
+    static constexpr size_t alignment_ = std::max(alignof(T), sizeof(void*));
+    static constexpr size_t allocation_size_ = (sizeof(T) * S + alignment_ - 1) / alignment_ * alignment_;
+
+    struct alignas(cache_line_size_) reader_state
+    {
+        std::atomic<size_t> head_;
+        // Only accessed by the reader.
+        size_t cached_tail_;
+    };
+
+    T* elements_;
+    Allocator allocator_;
+    // Owned by the producer, cached_min_head_ is the slowest reader head as last seen by the producer.
+    alignas(cache_line_size_) std::atomic<size_t> tail_;
+    size_t cached_min_head_;
+    reader_state readers_[R];
+
+    bool is_full(const size_t tail) noexcept
+    {
+        if (tail - cached_min_head_ < S)
+        {
+            return false;
+        }
+
+        auto min_head = tail;
+        for (const auto& reader : readers_)
+        {
+            min_head = std::min(min_head, reader.head_.load(std::memory_order_acquire));
+        }
+        cached_min_head_ = min_head;
+        return tail - min_head >= S;
+    }
+
+    bool available(reader_state& state, const size_t head) noexcept
+    {
+        if (head != state.cached_tail_)
+        {
+            return true;
+        }
+        state.cached_tail_ = tail_.load(std::memory_order_acquire);
+        return head != state.cached_tail_;
+    }
+
+    template<typename... U>
+    void emplace(const size_t tail, U&&... item) noexcept
+    {
+        auto slot = &elements_[tail & mod_value_];
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            // Every reader has released the item of the previous lap.
+            if (tail >= S)
+            {
+                slot->~T();
+            }
+        }
+        new (slot) T(std::forward<U>(item)...);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+}// namespace waitfree
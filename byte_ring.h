@@ -0,0 +1,617 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "allocator.h"
+#include "cache_line.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+namespace waitfree
+{
+
+/**
+ * Contiguous bytes of a message in a byte ring, reserved for writing or read by the consumer.
+ *
+ * An empty span, data() == nullptr, is returned when there is no room for a reservation or no message to read.
+ */
+class byte_span
+{
+public:
+    byte_span() noexcept = default;
+
+    byte_span(std::byte* data, const size_t size) noexcept
+        : data_(data),
+          size_(size)
+    {
+    }
+
+    [[nodiscard]] std::byte* data() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return data_ == nullptr;
+    }
+
+    [[nodiscard]] std::byte* begin() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] std::byte* end() const noexcept
+    {
+        return data_ + size_;
+    }
+
+private:
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+namespace detail
+{
+
+/**
+ * Record format shared by the byte rings.
+ *
+ * Every record starts with an 8 byte header and is padded to a multiple of 8 bytes, so records and message data are
+ * 8 byte aligned and a record never wraps around the end of the buffer. The low 32 bits of the header hold the size
+ * of the record including the header, with the committed and padding flags in the low bits, and the high 32 bits hold
+ * the size of the message. A padding record fills the end of the buffer when a reservation does not fit there.
+ */
+struct byte_record
+{
+    static constexpr size_t header_size = sizeof(uint64_t);
+    static constexpr uint64_t committed = 1;
+    static constexpr uint64_t padding = 2;
+    static constexpr uint64_t record_mask = 0xfffffff8;
+
+    static constexpr size_t record_size(const size_t message_size) noexcept
+    {
+        return (header_size + message_size + header_size - 1) & ~(header_size - 1);
+    }
+
+    static constexpr uint64_t message_header(const size_t message_size, const size_t record) noexcept
+    {
+        return (static_cast<uint64_t>(message_size) << 32) | record | committed;
+    }
+
+    static constexpr uint64_t padding_header(const size_t record) noexcept
+    {
+        return record | padding | committed;
+    }
+
+    static constexpr size_t record_of(const uint64_t header) noexcept
+    {
+        return static_cast<size_t>(header & record_mask);
+    }
+
+    static constexpr size_t message_of(const uint64_t header) noexcept
+    {
+        return static_cast<size_t>(header >> 32);
+    }
+};
+
+}// namespace detail
+
+/**
+ * Wait-free, single producer, single consumer ring of variable length byte messages.
+ *
+ * Messages are stored back to back as length prefixed records, so memory scales with the bytes pushed rather than
+ * with the largest message. The producer reserves room with reserve(), writes the message in place and publishes it
+ * with commit(), the consumer reads it in place with read() and frees it with release().
+ *
+ * S is the size of the buffer in bytes, a power of 2 and at least 64. The largest message is max_message_size(),
+ * half the buffer minus a header, which always fits once the ring is drained.
+ * Allocator allocates the buffer, see allocator.h.
+ */
+template<size_t S, typename Allocator = default_allocator>
+class spsc_byte_ring
+{
+public:
+    spsc_byte_ring()
+        : spsc_byte_ring(Allocator())
+    {
+    }
+
+    /**
+     * Constructs a ring that allocates its buffer from allocator.
+     */
+    explicit spsc_byte_ring(const Allocator& allocator)
+        : allocator_(allocator),
+          head_(0),
+          cached_tail_(0),
+          tail_(0),
+          cached_head_(0),
+          reserved_padding_(0)
+    {
+        static_assert(is_power_of_two(S) && S >= 64 && S <= (size_t(1) << 31));
+
+        buffer_ = static_cast<std::byte*>(allocator_.allocate(S, cache_line_size_));
+        if (!buffer_)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    spsc_byte_ring(const spsc_byte_ring&) = delete;
+    spsc_byte_ring& operator=(const spsc_byte_ring&) = delete;
+
+    ~spsc_byte_ring()
+    {
+        allocator_.deallocate(buffer_, S, cache_line_size_);
+    }
+
+    /**
+     * @brief Reserves room for a message of size bytes.
+     *
+     * @details
+     * Returns the bytes to write the message to, or an empty span if the ring is too full or size is larger than
+     * max_message_size(). The message is not visible to the consumer until it is passed to commit(), and only one
+     * message can be reserved at a time.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    [[nodiscard]] byte_span reserve(const size_t size) noexcept
+    {
+        if (size > max_message_size())
+        {
+            return {};
+        }
+
+        const auto record = detail::byte_record::record_size(size);
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        const auto contiguous = S - (tail & mod_value_);
+        const auto padding = contiguous < record ? contiguous : 0;
+        if (tail + padding + record - cached_head_ > S)
+        {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail + padding + record - cached_head_ > S)
+            {
+                return {};
+            }
+        }
+
+        reserved_padding_ = padding;
+        return byte_span(buffer_ + ((tail + padding) & mod_value_) + detail::byte_record::header_size, size);
+    }
+
+    /**
+     * @brief Publishes the message reserved with reserve() to the consumer.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    void commit(const byte_span& reserved) noexcept
+    {
+        commit(reserved, reserved.size());
+    }
+
+    /**
+     * @brief Publishes the first size bytes of the message reserved with reserve() to the consumer.
+     *
+     * @details
+     * Lets a message be reserved for its largest size and committed with the size actually written, the unused
+     * bytes are returned to the ring. Will assert if size is larger than the reservation if asserts are enabled.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    void commit([[maybe_unused]] const byte_span& reserved, const size_t size) noexcept
+    {
+        assert(size <= reserved.size());
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (reserved_padding_ != 0)
+        {
+            write_header(tail, detail::byte_record::padding_header(reserved_padding_));
+            tail += reserved_padding_;
+        }
+        assert(buffer_ + (tail & mod_value_) + detail::byte_record::header_size == reserved.data());
+
+        const auto record = detail::byte_record::record_size(size);
+        write_header(tail, detail::byte_record::message_header(size, record));
+        tail_.store(tail + record, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies size bytes from data to the ring as one message.
+     *
+     * @details
+     * Returns false without modifying the ring if the message does not fit, otherwise true.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    bool push(const void* data, const size_t size) noexcept
+    {
+        const auto reserved = reserve(size);
+        if (reserved.empty())
+        {
+            return false;
+        }
+
+        std::memcpy(reserved.data(), data, size);
+        commit(reserved);
+        return true;
+    }
+
+    /**
+     * @brief Returns the message at the head of the ring without removing it.
+     *
+     * @details
+     * Returns an empty span if the ring is empty. The bytes are valid until release() is called.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    [[nodiscard]] byte_span read() noexcept
+    {
+        for (;;)
+        {
+            const auto head = head_.load(std::memory_order_relaxed);
+            if (head == cached_tail_)
+            {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_)
+                {
+                    return {};
+                }
+            }
+
+            const auto header = read_header(head);
+            if ((header & detail::byte_record::padding) != 0)
+            {
+                head_.store(head + detail::byte_record::record_of(header), std::memory_order_release);
+                continue;
+            }
+            return byte_span(buffer_ + (head & mod_value_) + detail::byte_record::header_size,
+                             detail::byte_record::message_of(header));
+        }
+    }
+
+    /**
+     * @brief Removes the message returned by read() from the ring.
+     *
+     * @details
+     * Must only be called after read() returned a non empty span, which is invalidated by the call.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    void release() noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        assert(head != cached_tail_);
+        head_.store(head + detail::byte_record::record_of(read_header(head)), std::memory_order_release);
+    }
+
+    /**
+     * @brief Checks if the ring is empty.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations. Regarding
+     * thread safety empty() is considered a pop operation.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the size of the buffer in bytes.
+   */
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+    /**
+     * @brief Get the size of the largest message that can be reserved.
+   */
+    [[nodiscard]] static constexpr size_t max_message_size() noexcept
+    {
+        return S / 2 - detail::byte_record::header_size;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+    static constexpr size_t mod_value_ = S - 1;
+
+    alignas(cache_line_size_) std::byte* buffer_;
+    Allocator allocator_;
+    // Byte positions, they only grow and are masked to index the buffer.
+    alignas(cache_line_size_) std::atomic<uint64_t> head_;
+    uint64_t cached_tail_;
+    alignas(cache_line_size_) std::atomic<uint64_t> tail_;
+    uint64_t cached_head_;
+    size_t reserved_padding_;
+
+    void write_header(const uint64_t position, const uint64_t header) noexcept
+    {
+        std::memcpy(buffer_ + (position & mod_value_), &header, sizeof(header));
+    }
+
+    uint64_t read_header(const uint64_t position) const noexcept
+    {
+        uint64_t header;
+        std::memcpy(&header, buffer_ + (position & mod_value_), sizeof(header));
+        return header;
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+/**
+ * Multiple producer, single consumer ring of variable length byte messages.
+ *
+ * Uses the record format of spsc_byte_ring. Producers reserve room by advancing the shared tail with a compare and
+ * swap, so reserve() is lock-free rather than wait-free, and publish each record by storing its header. The consumer
+ * follows the committed headers from the head and zeroes every record it releases, which keeps stale bytes from being
+ * mistaken for a header on the next lap. Messages are read in reservation order, so an uncommitted reservation holds
+ * back the messages reserved after it.
+ *
+ * S is the size of the buffer in bytes, a power of 2 and at least 64. The largest message is max_message_size().
+ * Allocator allocates the buffer, see allocator.h.
+ */
+template<size_t S, typename Allocator = default_allocator>
+class mpsc_byte_ring
+{
+public:
+    mpsc_byte_ring()
+        : mpsc_byte_ring(Allocator())
+    {
+    }
+
+    /**
+     * Constructs a ring that allocates its buffer from allocator.
+     */
+    explicit mpsc_byte_ring(const Allocator& allocator)
+        : allocator_(allocator),
+          head_(0),
+          tail_(0)
+    {
+        static_assert(is_power_of_two(S) && S >= 64 && S <= (size_t(1) << 31));
+        static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+        buffer_ = static_cast<std::byte*>(allocator_.allocate(S, cache_line_size_));
+        if (!buffer_)
+        {
+            throw std::bad_alloc();
+        }
+        detail::zero_fill<Allocator>(buffer_, S);
+    }
+
+    mpsc_byte_ring(const mpsc_byte_ring&) = delete;
+    mpsc_byte_ring& operator=(const mpsc_byte_ring&) = delete;
+
+    ~mpsc_byte_ring()
+    {
+        allocator_.deallocate(buffer_, S, cache_line_size_);
+    }
+
+    /**
+     * @brief Reserves room for a message of size bytes.
+     *
+     * @details
+     * Returns the bytes to write the message to, or an empty span if the ring is too full or size is larger than
+     * max_message_size(). The message is not visible to the consumer until it is passed to commit(). Every non empty
+     * reservation must be committed.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    [[nodiscard]] byte_span reserve(const size_t size) noexcept
+    {
+        if (size > max_message_size())
+        {
+            return {};
+        }
+
+        const auto record = detail::byte_record::record_size(size);
+        auto tail = tail_.load(std::memory_order_relaxed);
+        size_t padding;
+        do
+        {
+            const auto contiguous = S - (tail & mod_value_);
+            padding = contiguous < record ? contiguous : 0;
+            // Signed, head_ can already be past a stale tail, the exchange then fails and reloads it.
+            const auto used = static_cast<int64_t>(tail + padding + record - head_.load(std::memory_order_acquire));
+            if (used > static_cast<int64_t>(S))
+            {
+                return {};
+            }
+        } while (!tail_.compare_exchange_weak(tail, tail + padding + record, std::memory_order_relaxed));
+
+        WAITFREE_STRESS_POINT();
+        if (padding != 0)
+        {
+            header_at(tail).store(detail::byte_record::padding_header(padding), std::memory_order_release);
+            tail += padding;
+        }
+        return byte_span(buffer_ + (tail & mod_value_) + detail::byte_record::header_size, size);
+    }
+
+    /**
+     * @brief Publishes a message reserved with reserve() to the consumer.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    void commit(const byte_span& reserved) noexcept
+    {
+        commit(reserved, reserved.size());
+    }
+
+    /**
+     * @brief Publishes the first size bytes of a message reserved with reserve() to the consumer.
+     *
+     * @details
+     * Lets a message be reserved for its largest size and committed with the size actually written. The record keeps
+     * its reserved size, the unused bytes are freed when the consumer releases it. Will assert if size is larger than
+     * the reservation if asserts are enabled.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    void commit(const byte_span& reserved, const size_t size) noexcept
+    {
+        assert(size <= reserved.size());
+        auto& header = *reinterpret_cast<std::atomic<uint64_t>*>(reserved.data() - detail::byte_record::header_size);
+        header.store(detail::byte_record::message_header(size, detail::byte_record::record_size(reserved.size())),
+                     std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies size bytes from data to the ring as one message.
+     *
+     * @details
+     * Returns false without modifying the ring if the message does not fit, otherwise true.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    bool push(const void* data, const size_t size) noexcept
+    {
+        const auto reserved = reserve(size);
+        if (reserved.empty())
+        {
+            return false;
+        }
+
+        std::memcpy(reserved.data(), data, size);
+        commit(reserved);
+        return true;
+    }
+
+    /**
+     * @brief Returns the message at the head of the ring without removing it.
+     *
+     * @details
+     * Returns an empty span if the ring is empty or the message at the head is not committed yet. The bytes are
+     * valid until release() is called.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    [[nodiscard]] byte_span read() noexcept
+    {
+        for (;;)
+        {
+            const auto head = head_.load(std::memory_order_relaxed);
+            const auto header = header_at(head).load(std::memory_order_acquire);
+            if ((header & detail::byte_record::committed) == 0)
+            {
+                return {};
+            }
+
+            if ((header & detail::byte_record::padding) != 0)
+            {
+                free_record(head, detail::byte_record::record_of(header));
+                continue;
+            }
+            return byte_span(buffer_ + (head & mod_value_) + detail::byte_record::header_size,
+                             detail::byte_record::message_of(header));
+        }
+    }
+
+    /**
+     * @brief Removes the message returned by read() from the ring.
+     *
+     * @details
+     * Must only be called after read() returned a non empty span, which is invalidated by the call.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    void release() noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        const auto header = header_at(head).load(std::memory_order_relaxed);
+        assert((header & detail::byte_record::committed) != 0);
+        free_record(head, detail::byte_record::record_of(header));
+    }
+
+    /**
+     * @brief Checks if the ring has no committed message at the head.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations. Regarding
+     * thread safety empty() is considered a pop operation.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return (header_at(head_.load(std::memory_order_relaxed)).load(std::memory_order_acquire) &
+                detail::byte_record::committed) == 0;
+    }
+
+    /**
+     * @brief Get the size of the buffer in bytes.
+   */
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+    /**
+     * @brief Get the size of the largest message that can be reserved.
+   */
+    [[nodiscard]] static constexpr size_t max_message_size() noexcept
+    {
+        return S / 2 - detail::byte_record::header_size;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+    static constexpr size_t mod_value_ = S - 1;
+
+    alignas(cache_line_size_) std::byte* buffer_;
+    Allocator allocator_;
+    // Byte positions, they only grow and are masked to index the buffer.
+    alignas(cache_line_size_) std::atomic<uint64_t> head_;
+    alignas(cache_line_size_) std::atomic<uint64_t> tail_;
+
+    std::atomic<uint64_t>& header_at(const uint64_t position) const noexcept
+    {
+        return *reinterpret_cast<std::atomic<uint64_t>*>(buffer_ + (position & mod_value_));
+    }
+
+    void free_record(const uint64_t head, const size_t record) noexcept
+    {
+        // Producers only write past head_, so the bytes are zero again before they can be reserved.
+        std::memset(buffer_ + (head & mod_value_), 0, record);
+        head_.store(head + record, std::memory_order_release);
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+}// namespace waitfree
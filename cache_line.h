@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+#include <cstddef>
+#include <new>
+
+/**
+ * WAITFREE_CACHE_LINE_SIZE is the alignment used to keep data written by different threads on separate cache lines.
+ *
+ * Define it before including any of the queues to override the detected value, for example to 128 on x86 where the
+ * adjacent line prefetcher pulls in pairs of lines. It must be the same in every translation unit of a program.
+ * Otherwise it is 128 on Apple arm64, and the compiler's destructive interference size elsewhere, read from
+ * __GCC_DESTRUCTIVE_SIZE (which std::hardware_destructive_interference_size is defined from, without its ABI warning
+ * on gcc) or std::hardware_destructive_interference_size, falling back to 64.
+ */
+#ifndef WAITFREE_CACHE_LINE_SIZE
+#if defined(__APPLE__) && defined(__aarch64__)
+#define WAITFREE_CACHE_LINE_SIZE 128
+#elif defined(__GCC_DESTRUCTIVE_SIZE)
+#define WAITFREE_CACHE_LINE_SIZE __GCC_DESTRUCTIVE_SIZE
+#elif defined(__cpp_lib_hardware_interference_size)
+#define WAITFREE_CACHE_LINE_SIZE std::hardware_destructive_interference_size
+#else
+#define WAITFREE_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+/**
+ * WAITFREE_STRESS_POINT() marks the windows of the queue protocols where another thread running in between matters,
+ * for example between reserving a slot and publishing it. It expands to nothing unless it is defined before including
+ * any of the queues. The stress tests define it to inject randomized delays, see test/test_stress.cpp.
+ */
+#ifndef WAITFREE_STRESS_POINT
+#define WAITFREE_STRESS_POINT()
+#endif
+
+namespace waitfree
+{
+
+inline constexpr size_t cache_line_size = WAITFREE_CACHE_LINE_SIZE;
+
+static_assert(cache_line_size != 0 && (cache_line_size & (cache_line_size - 1)) == 0,
+              "WAITFREE_CACHE_LINE_SIZE must be a power of 2");
+
+namespace detail
+{
+
+/**
+ * Hints the processor to fetch the cache line holding address for reading. A no-op where there is no prefetch
+ * instruction.
+ */
+inline void prefetch_read([[maybe_unused]] const void* address) noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#endif
+}
+
+/**
+ * Hints the processor to fetch the cache line holding address in exclusive state, ready to be written. PREFETCHW on
+ * x86 when the target supports it, otherwise a read prefetch.
+ */
+inline void prefetch_write([[maybe_unused]] const void* address) noexcept
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _m_prefetchw(address);
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 1, 3);
+#endif
+}
+
+}// namespace detail
+
+}// namespace waitfree
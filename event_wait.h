@@ -0,0 +1,268 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "cache_line.h"
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#define WAITFREE_EVENT_WAIT_UNDEF_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define WAITFREE_EVENT_WAIT_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef WAITFREE_EVENT_WAIT_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef WAITFREE_EVENT_WAIT_UNDEF_NOMINMAX
+#endif
+#ifdef WAITFREE_EVENT_WAIT_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef WAITFREE_EVENT_WAIT_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <poll.h>
+#include <sys/event.h>
+#include <unistd.h>
+#else
+#error "event_wait.h supports Linux (eventfd), macOS (kqueue) and Windows (IOCP)"
+#endif
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+
+namespace waitfree
+{
+
+/**
+ * Wait strategy that signals a pollable handle, so a consumer can wait for a queue in an existing event loop.
+ *
+ * The handle is an eventfd on Linux and a kqueue with an EVFILT_USER event on macOS, both readable when signaled and
+ * usable with epoll, kqueue, poll or select, and an I/O completion port on Windows. Producers only signal it when the
+ * consumer has armed it after finding the queue empty, so a burst of pushes costs at most one system call. notify()
+ * otherwise costs a full memory fence and a load of a line that is only written by the consumer when it arms.
+ *
+ * Consumer loop:
+ *     for (;;) {
+ *         while (queue.pop(item)) { ... }
+ *         queue.wait_strategy().arm();
+ *         if (!queue.empty()) continue;          // pushed while arming, the handle may be signaled as well
+ *         wait for native_handle() in the event loop, then call queue.wait_strategy().clear();
+ *     }
+ *
+ * pop_wait() waits on the handle itself. Throws std::system_error if the handle cannot be created.
+ */
+class event_wait
+{
+public:
+#if defined(_WIN32)
+    using native_handle_type = HANDLE;
+#else
+    using native_handle_type = int;
+#endif
+
+    event_wait()
+    {
+#if defined(_WIN32)
+        handle_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        if (handle_ == nullptr)
+        {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateIoCompletionPort");
+        }
+#elif defined(__linux__)
+        handle_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (handle_ < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "eventfd");
+        }
+#else
+        handle_ = kqueue();
+        if (handle_ < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "kqueue");
+        }
+        struct kevent event;
+        EV_SET(&event, user_event_ident_, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        if (kevent(handle_, &event, 1, nullptr, 0, nullptr) < 0)
+        {
+            const auto error = errno;
+            close(handle_);
+            throw std::system_error(error, std::generic_category(), "kevent");
+        }
+#endif
+    }
+
+    event_wait(const event_wait&) = delete;
+    event_wait& operator=(const event_wait&) = delete;
+
+    ~event_wait()
+    {
+#if defined(_WIN32)
+        CloseHandle(handle_);
+#else
+        close(handle_);
+#endif
+    }
+
+    void notify() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (armed_.load(std::memory_order_relaxed) != 0 && armed_.exchange(0, std::memory_order_relaxed) != 0)
+        {
+            signal();
+        }
+    }
+
+    template<typename Ready>
+    bool wait_until(Ready&& ready, const std::chrono::steady_clock::time_point deadline) noexcept
+    {
+        for (;;)
+        {
+            if (ready())
+            {
+                return true;
+            }
+
+            arm();
+            if (ready())
+            {
+                disarm();
+                return true;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                disarm();
+                return ready();
+            }
+            wait_for_signal(deadline - now);
+            clear();
+        }
+    }
+
+    /**
+     * @brief Asks producers to signal the handle on their next publish.
+     *
+     * @details
+     * The consumer must check the queue again after arming, before waiting for the handle, otherwise an item
+     * published while arming could go unnoticed.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations.
+   */
+    void arm() noexcept
+    {
+        armed_.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * @brief Withdraws arm() without waiting for a signal.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations.
+   */
+    void disarm() noexcept
+    {
+        armed_.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Resets a signaled handle, call it after the event loop reported the handle ready.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations.
+   */
+    void clear() noexcept
+    {
+        disarm();
+#if defined(_WIN32)
+        DWORD bytes;
+        ULONG_PTR key;
+        LPOVERLAPPED overlapped;
+        while (GetQueuedCompletionStatus(handle_, &bytes, &key, &overlapped, 0))
+        {
+        }
+#elif defined(__linux__)
+        uint64_t value;
+        [[maybe_unused]] const auto result = read(handle_, &value, sizeof(value));
+#else
+        struct kevent event;
+        const timespec no_wait{0, 0};
+        kevent(handle_, nullptr, 0, &event, 1, &no_wait);
+#endif
+    }
+
+    /**
+     * @brief Get the handle to wait for, owned by the wait strategy.
+   */
+    [[nodiscard]] native_handle_type native_handle() const noexcept
+    {
+        return handle_;
+    }
+
+private:
+    static constexpr uintptr_t user_event_ident_ = 1;
+
+    native_handle_type handle_;
+    alignas(cache_line_size) std::atomic<uint32_t> armed_{0};
+
+    void signal() noexcept
+    {
+#if defined(_WIN32)
+        PostQueuedCompletionStatus(handle_, 0, 0, nullptr);
+#elif defined(__linux__)
+        const uint64_t value = 1;
+        [[maybe_unused]] const auto result = write(handle_, &value, sizeof(value));
+#else
+        struct kevent event;
+        EV_SET(&event, user_event_ident_, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        kevent(handle_, &event, 1, nullptr, 0, nullptr);
+#endif
+    }
+
+    void wait_for_signal(const std::chrono::nanoseconds timeout) noexcept
+    {
+        const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count() + 1;
+#if defined(_WIN32)
+        DWORD bytes;
+        ULONG_PTR key;
+        LPOVERLAPPED overlapped;
+        GetQueuedCompletionStatus(handle_, &bytes, &key, &overlapped,
+                                  milliseconds >= INFINITE ? INFINITE - 1 : static_cast<DWORD>(milliseconds));
+#else
+        pollfd descriptor{handle_, POLLIN, 0};
+        poll(&descriptor, 1, milliseconds >= INT32_MAX ? INT32_MAX : static_cast<int>(milliseconds));
+#endif
+    }
+};
+
+}// namespace waitfree
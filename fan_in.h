@@ -0,0 +1,303 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "cache_line.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace waitfree
+{
+
+namespace detail
+{
+
+inline unsigned count_trailing_zeros(const uint64_t value) noexcept
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+inline unsigned popcount(const uint64_t value) noexcept
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(value));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(value));
+#endif
+}
+
+}// namespace detail
+
+/**
+ * Bitmap with one bit per queue that producers set after pushing, so that a consumer servicing many queues only
+ * visits the ones that may hold items.
+ *
+ * Each 64 bit word lives on its own cache line, producers of queues in different words never share a line. A
+ * producer only writes the word when its bit is clear, so a queue that stays busy costs its producer a fence and a
+ * load of a line that is usually shared.
+ *
+ * N is the number of queues.
+ */
+template<size_t N>
+class ready_bitmap
+{
+public:
+    static constexpr size_t word_count = (N + 63) / 64;
+
+    ready_bitmap() noexcept
+    {
+        for (auto& word : words_)
+        {
+            word.bits_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ready_bitmap(const ready_bitmap&) = delete;
+    ready_bitmap& operator=(const ready_bitmap&) = delete;
+
+    /**
+     * @brief Marks queue index as ready, to be called after pushing to it.
+     *
+     * Thread safe with regards to other set operations and to take operations.
+   */
+    void set(const size_t index) noexcept
+    {
+        assert(index < N);
+        auto& bits = words_[index / 64].bits_;
+        const auto mask = uint64_t(1) << (index % 64);
+        // Orders the push before the load, pairs with the fence in take(). If the consumer took the word after the
+        // load saw the bit set, it reads the queue after the push.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((bits.load(std::memory_order_relaxed) & mask) == 0)
+        {
+            bits.fetch_or(mask, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief Clears word and returns the bits that were set in it.
+     *
+     * @details
+     * Queues pushed to after take() returns get their bit set again, so the consumer must check every queue
+     * returned before dropping it.
+     *
+     * Only to be called by the consumer. Thread safe with regards to set operations.
+   */
+    [[nodiscard]] uint64_t take(const size_t word) noexcept
+    {
+        assert(word < word_count);
+        const auto bits = words_[word].bits_.exchange(0, std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return bits;
+    }
+
+    /**
+     * @brief Get the number of queues marked as ready.
+     *
+     * @details
+     * The result is a snapshot when the bitmap is concurrently modified.
+   */
+    [[nodiscard]] size_t count() const noexcept
+    {
+        size_t result = 0;
+        for (const auto& word : words_)
+        {
+            result += detail::popcount(word.bits_.load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+
+    struct alignas(cache_line_size_) word
+    {
+        std::atomic<uint64_t> bits_;
+    };
+
+    word words_[word_count];
+};
+
+/**
+ * N queues serviced by a single consumer through a ready_bitmap.
+ *
+ * Queue is a queue type with push, try_push and pop(T&), such as spsc_queue, spsc_queue_fast or mpsc_queue. Each
+ * queue keeps its own producer rules, the fan_in only adds the bitmap update after a push. pop() visits ready queues
+ * round robin, so its cost follows the number of active queues instead of N.
+ *
+ * N is the number of queues.
+ */
+template<typename Queue, size_t N>
+class fan_in
+{
+public:
+    /**
+     * Constructs N queues, passing args to the constructor of each one.
+     */
+    template<typename... Args>
+    explicit fan_in(const Args&... args)
+        : cursor_(0)
+    {
+        static_assert(N != 0);
+        for (auto& queue : queues_)
+        {
+            queue = std::make_unique<Queue>(args...);
+        }
+        for (size_t i = 0; i < word_count_; ++i)
+        {
+            pending_[i] = 0;
+            again_[i] = 0;
+        }
+    }
+
+    fan_in(const fan_in&) = delete;
+    fan_in& operator=(const fan_in&) = delete;
+
+    /**
+     * @brief Get queue index, for direct access by its producer.
+     *
+     * Items pushed directly have to be followed by ready().set(index) to be seen by pop().
+   */
+    [[nodiscard]] Queue& queue(const size_t index) noexcept
+    {
+        assert(index < N);
+        return *queues_[index];
+    }
+
+    [[nodiscard]] ready_bitmap<N>& ready() noexcept
+    {
+        return ready_;
+    }
+
+    /**
+     * @brief Pushes an item to queue index and marks it as ready.
+     *
+     * Thread safety is that of Queue::push for the queue, and safe with regards to pushes to other queues and pop.
+   */
+    template<typename... U>
+    void push(const size_t index, U&&... item) noexcept
+    {
+        queue(index).push(std::forward<U>(item)...);
+        ready_.set(index);
+    }
+
+    /**
+     * @brief Tries to push an item to queue index and marks it as ready.
+     *
+     * @details
+     * Returns false without modifying the queue if it is full, otherwise true.
+     *
+     * Thread safety is that of Queue::try_push for the queue, and safe with regards to pushes to other queues and
+     * pop.
+   */
+    template<typename... U>
+    bool try_push(const size_t index, U&&... item) noexcept
+    {
+        if (!queue(index).try_push(std::forward<U>(item)...))
+        {
+            return false;
+        }
+        ready_.set(index);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the next ready queue.
+     *
+     * @details
+     * Returns false if no queue holds an item, otherwise true and the index of the queue the item came from. item and
+     * index are only valid if the function returns true. A queue that yields an item is visited again only after the
+     * other ready queues of its word.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename T>
+    bool pop(T& item, size_t& index) noexcept
+    {
+        for (size_t empty_words = 0; empty_words <= word_count_;)
+        {
+            auto& pending = pending_[cursor_];
+            if (pending == 0)
+            {
+                cursor_ = cursor_ + 1 == word_count_ ? 0 : cursor_ + 1;
+                pending_[cursor_] = again_[cursor_] | ready_.take(cursor_);
+                again_[cursor_] = 0;
+                if (pending_[cursor_] == 0)
+                {
+                    ++empty_words;
+                }
+                continue;
+            }
+
+            const auto bit = detail::count_trailing_zeros(pending);
+            const auto mask = uint64_t(1) << bit;
+            pending &= ~mask;
+            const auto candidate = cursor_ * 64 + bit;
+            if (queues_[candidate]->pop(item))
+            {
+                again_[cursor_] |= mask;
+                index = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename T>
+    bool pop(T& item) noexcept
+    {
+        size_t index;
+        return pop(item, index);
+    }
+
+private:
+    static constexpr size_t word_count_ = ready_bitmap<N>::word_count;
+
+    std::unique_ptr<Queue> queues_[N];
+    ready_bitmap<N> ready_;
+
+    // Only accessed by the consumer. pending_ holds the taken bits still to visit, again_ the queues that yielded an
+    // item and are visited the next time their word comes up.
+    size_t cursor_;
+    uint64_t pending_[word_count_];
+    uint64_t again_[word_count_];
+};
+
+}// namespace waitfree
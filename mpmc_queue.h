@@ -0,0 +1,306 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "allocator.h"
+#include "cache_line.h"
+#include "mpsc_queue.h"
+#include "wait_strategy.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace waitfree
+{
+
+/**
+ * Multiple producer, multiple consumer queue.
+ *
+ * push is not lock-free: it reserves a position before checking the slot, so it waits when it laps a consumer that
+ * is still moving an item out, and on a full queue until a consumer makes room. try_push and pop never wait for
+ * another thread, use try_push where producers must not block.
+ *
+ * Uses the slot layouts and lap relative sequence numbers of mpsc_queue. Producers and consumers reserve positions
+ * on separate counters and hand items over through the sequence number of the slot, so the two sides only meet on a
+ * slot when the queue is close to full or empty.
+ *
+ * T is the type of the elements in the queue.
+ * S is the maximum number of elements in the queue. S must be a power of 2 and at least 2.
+ * Layout is the slot layout, padded_layout or packed_layout.
+ * Allocator allocates the element buffer, see allocator.h.
+ */
+template<typename T, size_t S, typename Layout = padded_layout, typename Allocator = default_allocator>
+class mpmc_queue
+{
+    using element = typename Layout::template element<T>;
+
+public:
+    mpmc_queue()
+        : mpmc_queue(Allocator())
+    {
+    }
+
+    /**
+     * Constructs a queue that allocates its buffer from allocator.
+     */
+    explicit mpmc_queue(const Allocator& allocator)
+        : allocator_(allocator),
+          head_(0),
+          tail_(0)
+    {
+        static_assert(is_power_of_two(S) && S >= 2);
+
+        auto alloc_result = allocator_.allocate(allocation_size_, alignment_);
+        if (!alloc_result)
+        {
+            throw std::bad_alloc();
+        }
+        detail::zero_fill<Allocator>(alloc_result, allocation_size_);
+        elements_ = reinterpret_cast<element*>(alloc_result);
+    }
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    ~mpmc_queue()
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (size_t i = 0; i < S; ++i)
+            {
+                // Relaxed, destroying the queue already has to happen after every push and pop, for example by joining
+                // the producer threads.
+                if ((elements_[i].sequence_.load(std::memory_order_relaxed) & mod_value_) != 1)
+                {
+                    continue;
+                }
+                (&elements_[i].value_)->~T();
+            }
+        }
+        allocator_.deallocate(elements_, allocation_size_, alignment_);
+    }
+
+    /**
+     * @brief Pushes an item to the queue.
+     *
+     * @details
+     * Reserves a position with a single fetch_add. If a consumer is still moving the item of the previous lap out of
+     * the slot, or the queue is full, waits until the slot is released, so push blocks behind a stalled consumer. The
+     * queue should be dimensioned so that it never gets full, try_push is the lock-free alternative.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    void push(U&&... item) noexcept
+    {
+        const auto tail = tail_.fetch_add(1, std::memory_order_relaxed);
+        WAITFREE_STRESS_POINT();
+        auto& element = elements_[tail & mod_value_];
+        for (uint32_t spins = 0; element.sequence_.load(std::memory_order_acquire) != lap(tail); ++spins)
+        {
+            if (spins < max_spins_)
+            {
+                detail::cpu_relax();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        new (&element.value_) T(std::forward<U>(item)...);
+        element.sequence_.store(published(tail), std::memory_order_release);
+    }
+
+    /**
+     * @brief Tries to push an item to the queue.
+     *
+     * @details
+     * Returns false without modifying the queue if the queue is full, otherwise pushes the item and returns true.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    bool try_push(U&&... item) noexcept
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& element = elements_[tail & mod_value_];
+            const auto sequence = element.sequence_.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::make_signed_t<uint_fast32_t>>(sequence - lap(tail));
+            if (difference == 0)
+            {
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    new (&element.value_) T(std::forward<U>(item)...);
+                    element.sequence_.store(published(tail), std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Pops an item from the queue.
+     *
+     * @details
+     * Returns false if the queue is empty, otherwise true. item is only valid if the function returns true.
+     * A failed attempt to reserve the head is only retried when another consumer reserved it first.
+     *
+     * Thread safe with regards to other pop operations and to push operations.
+   */
+    bool pop(T& item) noexcept
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& element = elements_[head & mod_value_];
+            const auto sequence = element.sequence_.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::make_signed_t<uint_fast32_t>>(sequence - published(head));
+            if (difference == 0)
+            {
+                if (head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    WAITFREE_STRESS_POINT();
+                    extract(element.value_, item);
+                    element.sequence_.store(released(head), std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                head = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Checks if the queue is empty
+     *
+     * @details
+     * Returns true if the queue is empty, otherwise false. The result is a snapshot when the queue is concurrently
+     * modified.
+     *
+     * Thread safe with regards to push and pop operations.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        return elements_[head & mod_value_].sequence_.load(std::memory_order_acquire) != published(head);
+    }
+
+    /**
+     * @brief Faults in every page of the element buffer from the calling thread.
+     *
+     * @details
+     * Useful with an allocator that returns zeroed memory, such as mmap_allocator, to place and warm the buffer on
+     * a thread of the caller's choice instead of the constructing thread. The contents are not changed.
+     *
+     * Must be called before the queue is used, not thread safe with regards to any other operation.
+   */
+    void prefault() noexcept
+    {
+        detail::prefault(elements_, allocation_size_);
+    }
+
+    /**
+     * @brief Get the maximum number of elements in the queue.
+   */
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+    static constexpr uint32_t max_spins_ = 64;
+    static constexpr size_t mod_value_ = S - 1;
+    static constexpr size_t alignment_ = std::max(alignof(element), sizeof(void*));
+    static constexpr size_t allocation_size_ = (sizeof(element) * S + alignment_ - 1) / alignment_ * alignment_;
+
+    alignas(cache_line_size_) element* elements_;
+    Allocator allocator_;
+    alignas(cache_line_size_) std::atomic<uint_fast32_t> head_;
+    alignas(cache_line_size_) std::atomic<uint_fast32_t> tail_;
+
+    static constexpr uint_fast32_t lap(const uint_fast32_t position) noexcept
+    {
+        return position & ~static_cast<uint_fast32_t>(mod_value_);
+    }
+
+    static constexpr uint_fast32_t published(const uint_fast32_t position) noexcept
+    {
+        return lap(position) + 1;
+    }
+
+    static constexpr uint_fast32_t released(const uint_fast32_t position) noexcept
+    {
+        return static_cast<uint_fast32_t>(lap(position) + S);
+    }
+
+    template<typename U>
+    static void extract(T& value, U&& item) noexcept
+    {
+        if constexpr (std::is_move_assignable_v<T>)
+        {
+            item = std::move(value);
+        }
+        else
+        {
+            item = value;
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                (&value)->~T();
+            }
+        }
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+}// namespace waitfree
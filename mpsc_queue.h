@@ -24,71 +24,180 @@ SOFTWARE.
 
 #pragma once
 
+#include "allocator.h"
+#include "cache_line.h"
+#include "statistics.h"
+#include "tracing.h"
+#include "wait_strategy.h"
 #include <atomic>
-#ifdef _WIN32
-#include <malloc.h>
-#endif
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <csignal>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 #include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
 namespace waitfree
 {
 
+/**
+ * Slot layouts for mpsc_queue.
+ *
+ * Each slot holds a value and a sequence number. sequence_ is relative to the first position of the lap, which lets
+ * a zeroed buffer be a valid empty queue. For a position p in lap l = p & ~(S - 1) the slot is free when
+ * sequence_ == l, holds the item pushed at p when sequence_ == l + 1 and is released to the next lap when
+ * sequence_ == l + S.
+ */
+
+/**
+ * Every slot starts on its own cache line. Producers writing adjacent slots never share a line, at the cost of at
+ * least one cache line per slot.
+ */
+struct padded_layout
+{
+    template<typename T>
+    struct element
+    {
+        alignas(cache_line_size) T value_;
+        std::atomic<uint_fast32_t> sequence_;
+    };
+};
+
+/**
+ * The sequence number is stored right next to the value and slots are packed back to back. Small elements share
+ * cache lines, which keeps the footprint at sizeof(T) plus the sequence number per slot and lets the consumer stream
+ * through memory, but producers writing neighbouring slots will contend on the same line.
+ */
+struct packed_layout
+{
+    template<typename T>
+    struct element
+    {
+        T value_;
+        std::atomic<uint_fast32_t> sequence_;
+    };
+};
+
+/**
+ * padded_layout with the read_timestamp() of the publishing push stored in the slot, which enables
+ * pop(item, sojourn). The timestamp lives in the padding of the cache line, so slots only grow when T is larger than
+ * the line minus the sequence number and the timestamp.
+ */
+struct timestamped_layout
+{
+    template<typename T>
+    struct element
+    {
+        alignas(cache_line_size) T value_;
+        std::atomic<uint_fast32_t> sequence_;
+        uint64_t timestamp_;
+    };
+};
+
 /**
  * Wait-free, multiple producer, single consumer queue.
  *
  * T is the type of the elements in the queue.
- * S is the maximum number of elements in the queue. S must be a power of 2.
+ * S is the maximum number of elements in the queue. S must be a power of 2 and at least 2, or 0 to pass the
+ * capacity to the constructor instead.
+ * Layout is the slot layout, padded_layout, packed_layout or timestamped_layout.
+ * Allocator allocates the element buffer, see allocator.h.
+ * WaitStrategy decides how pop_wait waits for items, see wait_strategy.h.
+ * Statistics counts queue events, see statistics.h. The default no_statistics is compiled out.
  */
-template<typename T, size_t S>
+template<typename T, size_t S, typename Layout = padded_layout, typename Allocator = default_allocator, typename WaitStrategy = spin_wait,
+         typename Statistics = no_statistics>
 class mpsc_queue
 {
+    using element = typename Layout::template element<T>;
+
 public:
-    mpsc_queue()
-        : head_(0),
-          tail_(0)
+    using value_type = T;
+
+    /**
+     * Consecutive slots reserved by claim_bulk(). The items are accessed by index, they are not contiguous in memory.
+     */
+    class reservation
     {
-        static_assert(is_power_of_two(S));
-        constexpr auto alignment = std::max(alignof(T), sizeof(void*));
-        constexpr auto adjusted_size = round_up_to_multiple_of(sizeof(element) * S, alignment);
-#ifdef _WIN32
-        auto alloc_result = _aligned_malloc(adjusted_size, alignment);
-#else
-        auto alloc_result = aligned_alloc(alignment, adjusted_size);
-#endif
-        if (!alloc_result)
+    public:
+        [[nodiscard]] size_t size() const noexcept
         {
-            throw std::bad_alloc();
+            return count_;
         }
-        memset(alloc_result, 0, adjusted_size);
-        elements_ = reinterpret_cast<element*>(alloc_result);
+
+        [[nodiscard]] T& operator[](const size_t index) const noexcept
+        {
+            assert(index < count_);
+            return elements_[(first_ + index) & mod_value_].value_;
+        }
+
+    private:
+        friend class mpsc_queue;
+
+        reservation(element* elements, const size_t mod_value, const uint_fast32_t first, const size_t count)
+            : elements_(elements),
+              mod_value_(mod_value),
+              first_(first),
+              count_(count)
+        {
+        }
+
+        element* elements_;
+        size_t mod_value_;
+        uint_fast32_t first_;
+        size_t count_;
+    };
+
+    template<size_t N = S, std::enable_if_t<N != 0, int> = 0>
+    mpsc_queue()
+        : mpsc_queue(construct_tag(), S, Allocator())
+    {
+        static_assert(is_power_of_two(S) && S >= 2);
+    }
+
+    /**
+     * Constructs a queue with a static capacity that allocates its buffer from allocator.
+     */
+    template<size_t N = S, std::enable_if_t<N != 0, int> = 0>
+    explicit mpsc_queue(const Allocator& allocator)
+        : mpsc_queue(construct_tag(), S, allocator)
+    {
+        static_assert(is_power_of_two(S) && S >= 2);
+    }
+
+    /**
+     * Constructs a queue with a capacity chosen at runtime, only available when S is 0.
+     * Throws std::invalid_argument if capacity is not a power of 2 or less than 2.
+     */
+    template<size_t N = S, std::enable_if_t<N == 0, int> = 0>
+    explicit mpsc_queue(const size_t capacity, const Allocator& allocator = Allocator())
+        : mpsc_queue(construct_tag(), capacity, allocator)
+    {
     }
 
     ~mpsc_queue()
     {
         if constexpr (!std::is_trivially_destructible_v<T>)
         {
-            for (size_t i = 0; i < S; ++i)
+            for (size_t i = 0; i < capacity(); ++i)
             {
-                if (elements_[i].is_used_.load(std::memory_order_seq_cst) == 0)
+                // Relaxed, destroying the queue already has to happen after every push and pop, for example by joining
+                // the producer threads.
+                if ((elements_[i].sequence_.load(std::memory_order_relaxed) & mod_value()) != 1)
                 {
                     continue;
                 }
                 (&elements_[i].value_)->~T();
             }
         }
-#ifdef _WIN32
-        _aligned_free(elements_);
-#else
-        free(elements_);
-#endif
+        allocator_.deallocate(elements_, allocation_size(), alignment_);
     }
 
     /**
@@ -103,10 +212,173 @@ public:
     template<typename... U>
     void push(U&&... item) noexcept
     {
-        const auto tail = tail_.fetch_add(1, std::memory_order_relaxed) & mod_value_;
-        new (&elements_[tail].value_) T(std::forward<U>(item)...);
-        assert(elements_[tail].is_used_.load(std::memory_order_acquire) == 0);
-        elements_[tail].is_used_.store(1, std::memory_order_release);
+        const auto tail = tail_.fetch_add(1, std::memory_order_relaxed);
+        auto& element = elements_[tail & mod_value()];
+        assert(element.sequence_.load(std::memory_order_acquire) == lap(tail));
+        WAITFREE_STRESS_POINT();
+        new (&element.value_) T(std::forward<U>(item)...);
+        stamp(element, enqueue_timestamp());
+        element.sequence_.store(published(tail), std::memory_order_release);
+        count_push(1, tail + 1);
+        waiter_.notify();
+    }
+
+    /**
+     * @brief Tries to push an item to the queue.
+     *
+     * @details
+     * Returns false without modifying the queue if the queue is full, otherwise pushes the item and returns true.
+     *
+     * Lock-free rather than wait-free, a failed attempt to reserve a slot is only retried when another producer
+     * reserved it first. push() stays wait-free.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    bool try_push(U&&... item) noexcept
+    {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& element = elements_[tail & mod_value()];
+            const auto sequence = element.sequence_.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::make_signed_t<uint_fast32_t>>(sequence - lap(tail));
+            if (difference == 0)
+            {
+                WAITFREE_STRESS_POINT();
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    new (&element.value_) T(std::forward<U>(item)...);
+                    stamp(element, enqueue_timestamp());
+                    element.sequence_.store(published(tail), std::memory_order_release);
+                    count_push(1, tail + 1);
+                    waiter_.notify();
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                count_full();
+                return false;
+            }
+            else
+            {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Reserves the next slot of the queue for in place production.
+     *
+     * @details
+     * Constructs an item in the slot from item, or default initializes it if no arguments are given, and returns a
+     * pointer to it. The item is not visible to the consumer until it is passed to commit(). Items are popped in
+     * reservation order, so an uncommitted slot holds back the items reserved after it.
+     * Will assert if the queue is full if asserts are enabled, otherwise the behaviour is undefined.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    [[nodiscard]] T* claim(U&&... item) noexcept
+    {
+        const auto tail = tail_.fetch_add(1, std::memory_order_relaxed);
+        auto& element = elements_[tail & mod_value()];
+        assert(element.sequence_.load(std::memory_order_acquire) == lap(tail));
+        count_push(1, tail + 1);
+        return construct(&element.value_, std::forward<U>(item)...);
+    }
+
+    /**
+     * @brief Reserves count consecutive slots of the queue with a single update of the tail.
+     *
+     * @details
+     * Default initializes the items and returns them as a reservation. Each item can be published on its own with
+     * commit(&reservation[i]), or all of them with commit(reservation). Like claim(), uncommitted slots hold back the
+     * items reserved after them.
+     * Will assert if the slots are not free if asserts are enabled, otherwise the behaviour is undefined.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    [[nodiscard]] reservation claim_bulk(const size_t count) noexcept
+    {
+        const auto first = tail_.fetch_add(static_cast<uint_fast32_t>(count), std::memory_order_relaxed);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto position = static_cast<uint_fast32_t>(first + i);
+            auto& element = elements_[position & mod_value()];
+            assert(element.sequence_.load(std::memory_order_acquire) == lap(position));
+            construct(&element.value_);
+        }
+        count_push(count, static_cast<uint_fast32_t>(first + count));
+        return reservation(elements_, mod_value(), first, count);
+    }
+
+    /**
+     * @brief Publishes all items of a reservation to the consumer, in order.
+     *
+     * Must not be combined with committing single items of the same reservation.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    void commit(const reservation& items) noexcept
+    {
+        const auto timestamp = enqueue_timestamp();
+        for (size_t i = 0; i < items.count_; ++i)
+        {
+            const auto position = static_cast<uint_fast32_t>(items.first_ + i);
+            auto& element = elements_[position & mod_value()];
+            stamp(element, timestamp);
+            WAITFREE_STRESS_POINT();
+            element.sequence_.store(published(position), std::memory_order_release);
+        }
+        waiter_.notify();
+    }
+
+    /**
+     * @brief Pushes the items in the range [first, last) to the queue with a single update of the tail.
+     *
+     * @details
+     * The items are pushed to consecutive slots and published in order. Will assert if the queue is full if asserts
+     * are enabled, otherwise the behaviour is undefined. Returns the number of pushed items.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename ForwardIt>
+    size_t push_bulk(ForwardIt first, const ForwardIt last) noexcept
+    {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        const auto tail = tail_.fetch_add(static_cast<uint_fast32_t>(count), std::memory_order_relaxed);
+        const auto timestamp = enqueue_timestamp();
+        for (size_t i = 0; i < count; ++i, ++first)
+        {
+            const auto position = static_cast<uint_fast32_t>(tail + i);
+            auto& element = elements_[position & mod_value()];
+            assert(element.sequence_.load(std::memory_order_acquire) == lap(position));
+            new (&element.value_) T(*first);
+            stamp(element, timestamp);
+            WAITFREE_STRESS_POINT();
+            element.sequence_.store(published(position), std::memory_order_release);
+        }
+        count_push(count, static_cast<uint_fast32_t>(tail + count));
+        waiter_.notify();
+        return count;
+    }
+
+    /**
+     * @brief Publishes an item reserved with claim() to the consumer.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    void commit(T* item) noexcept
+    {
+        const auto offset = reinterpret_cast<uintptr_t>(item) - reinterpret_cast<uintptr_t>(&elements_[0].value_);
+        const auto index = offset / sizeof(element);
+        auto& element = elements_[index];
+        stamp(element, enqueue_timestamp());
+        // The sequence of a reserved slot is only written by its producer, it still holds the lap of the claim.
+        element.sequence_.store(element.sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        waiter_.notify();
     }
 
     /**
@@ -119,28 +391,155 @@ public:
    */
     bool pop(T& item) noexcept
     {
-        const auto head = head_.fetch_add(1, std::memory_order_relaxed) & mod_value_;
-        if (elements_[head].is_used_.load(std::memory_order_acquire) == 0)
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& element = elements_[head & mod_value()];
+        if (element.sequence_.load(std::memory_order_acquire) != published(head))
         {
-            head_.fetch_sub(1, std::memory_order_relaxed);
+            count_empty();
             return false;
         }
 
-        if constexpr (std::is_move_assignable_v<T>)
+        prefetch_ahead(head);
+        extract(element.value_, item);
+        WAITFREE_STRESS_POINT();
+        element.sequence_.store(released(head), std::memory_order_release);
+        count_pop(1);
+        head_.store(head + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the queue and reports how long it was queued.
+     *
+     * @details
+     * Like pop(item), and sets sojourn to the read_timestamp() ticks from the publishing push to now, see
+     * timestamp_to_duration(). Only available with timestamped_layout. Pass the result to a trace_ring to export
+     * samples.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename E = element, std::enable_if_t<detail::has_timestamp_v<E>, int> = 0>
+    bool pop(T& item, uint64_t& sojourn) noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& element = elements_[head & mod_value()];
+        if (element.sequence_.load(std::memory_order_acquire) != published(head))
         {
-            item = std::move(elements_[head].value_);
+            count_empty();
+            return false;
         }
-        else
+
+        prefetch_ahead(head);
+        sojourn = detail::elapsed_ticks(element.timestamp_, read_timestamp());
+        extract(element.value_, item);
+        WAITFREE_STRESS_POINT();
+        element.sequence_.store(released(head), std::memory_order_release);
+        count_pop(1);
+        head_.store(head + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the queue, waiting up to timeout for one to be pushed.
+     *
+     * @details
+     * Returns false if the queue is still empty after timeout, otherwise true. item is only valid if the function
+     * returns true. How the consumer waits is decided by WaitStrategy, see wait_strategy.h.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename Rep, typename Period>
+    bool pop_wait(T& item, const std::chrono::duration<Rep, Period>& timeout) noexcept
+    {
+        if (pop(item))
         {
-            item = elements_[head].value_;
-            if constexpr (!std::is_trivially_destructible_v<T>)
+            return true;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        return waiter_.wait_until([this]() { return !empty(); }, deadline) && pop(item);
+    }
+
+    /**
+     * @brief Returns a pointer to the item at the head of the queue without popping it.
+     *
+     * @details
+     * Returns nullptr if the queue is empty. The pointer is valid until the item is popped.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations. Regarding
+     * thread safety front() is considered a pop operation.
+   */
+    [[nodiscard]] T* front() noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& element = elements_[head & mod_value()];
+        if (element.sequence_.load(std::memory_order_acquire) != published(head))
+        {
+            return nullptr;
+        }
+        return &element.value_;
+    }
+
+    /**
+     * @brief Pops the item at the head of the queue without copying it out.
+     *
+     * @details
+     * Must only be called after front() returned a non null pointer, which is invalidated by the call. The item is
+     * destroyed in place unless T is trivially destructible.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    void release() noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        auto& element = elements_[head & mod_value()];
+        assert(element.sequence_.load(std::memory_order_relaxed) == published(head));
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            (&element.value_)->~T();
+        }
+        element.sequence_.store(released(head), std::memory_order_release);
+        count_pop(1);
+        head_.store(head + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Pops up to max items from the queue.
+     *
+     * @details
+     * Pops consecutive items starting at the head of the queue and writes them to out, stopping at the first item
+     * that has not been published yet or when max items have been popped. The head of the queue is only updated once
+     * per call. Returns the number of items written to out.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename OutputIt>
+    size_t pop_bulk(OutputIt out, const size_t max) noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        size_t count = 0;
+        for (; count < max; ++count)
+        {
+            const auto position = static_cast<uint_fast32_t>(head + count);
+            auto& element = elements_[position & mod_value()];
+            if (element.sequence_.load(std::memory_order_acquire) != published(position))
             {
-                (&elements_[head].value_)->~T();
+                break;
             }
+
+            prefetch_ahead(position);
+            extract(element.value_, *out);
+            ++out;
+            element.sequence_.store(released(position), std::memory_order_release);
         }
 
-        elements_[head].is_used_.store(0, std::memory_order_relaxed);
-        return true;
+        if (count == 0)
+        {
+            count_empty();
+        }
+        count_pop(count);
+        head_.store(static_cast<uint_fast32_t>(head + count), std::memory_order_relaxed);
+        return count;
     }
 
     /**
@@ -154,23 +553,241 @@ public:
    */
     [[nodiscard]] bool empty() const noexcept
     {
-        const auto head = head_.load(std::memory_order_relaxed) & mod_value_;
-        return elements_[head].is_used_.load(std::memory_order_acquire) == 0;
+        const auto head = head_.load(std::memory_order_relaxed);
+        return elements_[head & mod_value()].sequence_.load(std::memory_order_acquire) != published(head);
     }
 
-private:
-    static constexpr size_t cache_line_size_ = 64;
-    static constexpr uint32_t mod_value_ = S - 1;
+    /**
+     * @brief Faults in every page of the element buffer from the calling thread.
+     *
+     * @details
+     * Useful with an allocator that returns zeroed memory, such as mmap_allocator, to place and warm the buffer on
+     * a thread of the caller's choice instead of the constructing thread. The contents are not changed.
+     *
+     * Must be called before the queue is used, not thread safe with regards to any other operation.
+   */
+    void prefault() noexcept
+    {
+        detail::prefault(elements_, allocation_size());
+    }
 
-    struct element
+    /**
+     * @brief Sets how many slots ahead of the head pop() and pop_bulk() prefetch, 0 disables prefetching.
+     *
+     * @details
+     * The slot at the head was just written by a producer core, so without prefetching every pop misses the cache.
+     * After a successful pop the slot distance positions ahead is prefetched, its value for reading and its sequence
+     * number for writing. Worth it for large T and a consumer that drains a backlog, a distance too short does not
+     * hide the miss and one too long prefetches slots producers are still writing. Disabled by default.
+     * Will assert if distance is not less than the capacity if asserts are enabled.
+     *
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations.
+   */
+    void set_prefetch_distance(const size_t distance) noexcept
     {
-        alignas(cache_line_size_) T value_;
-        std::atomic<uint_fast32_t> is_used_;
-    };
+        assert(distance < capacity());
+        prefetch_distance_ = static_cast<uint_fast32_t>(distance);
+    }
+
+    /**
+     * @brief Get the wait strategy, for integrations such as async_pop() in async_queue.h.
+   */
+    [[nodiscard]] WaitStrategy& wait_strategy() noexcept
+    {
+        return waiter_;
+    }
+
+    /**
+     * @brief Get the counters of the Statistics policy, all zero for no_statistics.
+     *
+     * Thread safe with regards to push and pop operations.
+   */
+    [[nodiscard]] statistics_snapshot statistics() const noexcept
+    {
+        return statistics_.snapshot();
+    }
+
+    /**
+     * @brief Get the maximum number of elements in the queue.
+   */
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        if constexpr (S != 0)
+        {
+            return S;
+        }
+        else
+        {
+            return capacity_;
+        }
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+
+    static constexpr size_t alignment_ = std::max(alignof(element), sizeof(void*));
 
     alignas(cache_line_size_) element* elements_;
+    Allocator allocator_;
+    // Only read when S is 0, the static capacity is a compile time constant.
+    size_t capacity_;
+    // Only accessed by the consumer, atomic so that the relaxed accesses compile to plain loads and stores.
     alignas(cache_line_size_) std::atomic<uint_fast32_t> head_;
+    // Only accessed by the consumer.
+    uint_fast32_t prefetch_distance_;
     alignas(cache_line_size_) std::atomic<uint_fast32_t> tail_;
+    WaitStrategy waiter_;
+    Statistics statistics_;
+
+    struct construct_tag
+    {
+    };
+
+    mpsc_queue(construct_tag, const size_t capacity, const Allocator& allocator)
+        : allocator_(allocator),
+          capacity_(capacity),
+          head_(0),
+          prefetch_distance_(0),
+          tail_(0)
+    {
+        if (!is_power_of_two(capacity) || capacity < 2)
+        {
+            throw std::invalid_argument("mpsc_queue capacity must be a power of 2 and at least 2");
+        }
+
+        const auto adjusted_size = allocation_size();
+        auto alloc_result = allocator_.allocate(adjusted_size, alignment_);
+        if (!alloc_result)
+        {
+            throw std::bad_alloc();
+        }
+        detail::zero_fill<Allocator>(alloc_result, adjusted_size);
+        elements_ = reinterpret_cast<element*>(alloc_result);
+    }
+
+    size_t allocation_size() const noexcept
+    {
+        return round_up_to_multiple_of(sizeof(element) * capacity(), alignment_);
+    }
+
+    size_t mod_value() const noexcept
+    {
+        return capacity() - 1;
+    }
+
+    uint_fast32_t lap(const uint_fast32_t position) const noexcept
+    {
+        return position & ~static_cast<uint_fast32_t>(mod_value());
+    }
+
+    uint_fast32_t published(const uint_fast32_t position) const noexcept
+    {
+        return lap(position) + 1;
+    }
+
+    uint_fast32_t released(const uint_fast32_t position) const noexcept
+    {
+        return static_cast<uint_fast32_t>(lap(position) + capacity());
+    }
+
+    void count_push(const size_t count, const uint_fast32_t end) noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            const auto occupancy = static_cast<uint_fast32_t>(end - head_.load(std::memory_order_relaxed));
+            statistics_.on_push(count, occupancy, capacity());
+        }
+    }
+
+    void count_full() noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_full();
+        }
+    }
+
+    void count_pop(const size_t count) noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_pop(count);
+        }
+    }
+
+    void count_empty() noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_empty();
+        }
+    }
+
+    void prefetch_ahead(const uint_fast32_t position) const noexcept
+    {
+        if (prefetch_distance_ == 0)
+        {
+            return;
+        }
+
+        const auto& element = elements_[(position + prefetch_distance_) & mod_value()];
+        const auto* value = reinterpret_cast<const char*>(&element.value_);
+        for (size_t offset = 0; offset < sizeof(T); offset += cache_line_size_)
+        {
+            detail::prefetch_read(value + offset);
+        }
+        detail::prefetch_write(&element.sequence_);
+    }
+
+    static uint64_t enqueue_timestamp() noexcept
+    {
+        if constexpr (detail::has_timestamp_v<element>)
+        {
+            return read_timestamp();
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    static void stamp([[maybe_unused]] element& slot, [[maybe_unused]] const uint64_t timestamp) noexcept
+    {
+        if constexpr (detail::has_timestamp_v<element>)
+        {
+            slot.timestamp_ = timestamp;
+        }
+    }
+
+    template<typename... U>
+    static T* construct(void* storage, U&&... item)
+    {
+        if constexpr (sizeof...(U) == 0)
+        {
+            return new (storage) T;
+        }
+        else
+        {
+            return new (storage) T(std::forward<U>(item)...);
+        }
+    }
+
+    template<typename U>
+    static void extract(T& value, U&& item) noexcept
+    {
+        if constexpr (std::is_move_assignable_v<T>)
+        {
+            item = std::move(value);
+        }
+        else
+        {
+            item = value;
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                (&value)->~T();
+            }
+        }
+    }
 
     static constexpr bool is_power_of_two(const size_t size)
     {
@@ -185,4 +802,11 @@ private:
     }
 };
 
+/**
+ * mpsc_queue with the capacity passed to the constructor.
+ */
+template<typename T, typename Layout = padded_layout, typename Allocator = default_allocator, typename WaitStrategy = spin_wait,
+         typename Statistics = no_statistics>
+using mpsc_queue_dyn = mpsc_queue<T, 0, Layout, Allocator, WaitStrategy, Statistics>;
+
 }// namespace waitfree
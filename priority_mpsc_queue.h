@@ -0,0 +1,233 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "cache_line.h"
+#include "fan_in.h"
+#include "mpsc_queue.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace waitfree
+{
+
+/**
+ * Multiple producer, single consumer queue with Lanes priority lanes, lane 0 having the highest priority.
+ *
+ * Each lane is an mpsc_queue. Producers keep a mask with one bit per lane that may hold items, so the consumer
+ * checks all lanes with a single load. pop() takes from the highest priority non empty lane, except that a lane
+ * passed over quantum times while non empty is served next, which bounds how long bulk lanes starve.
+ *
+ * T is the type of the elements in the queue.
+ * S is the maximum number of elements per lane. S must be a power of 2 and at least 2.
+ * Lanes is the number of priority lanes, at most 64.
+ * Layout is the slot layout of the lanes, padded_layout or packed_layout.
+ */
+template<typename T, size_t S, size_t Lanes, typename Layout = padded_layout>
+class priority_mpsc_queue
+{
+public:
+    static constexpr size_t default_quantum = 64;
+
+    /**
+     * Constructs a queue where a non empty lane is passed over at most quantum times in a row.
+     */
+    explicit priority_mpsc_queue(const size_t quantum = default_quantum)
+        : nonempty_(0),
+          quantum_(quantum)
+    {
+        static_assert(Lanes != 0 && Lanes <= 64);
+        for (auto& skipped : skipped_)
+        {
+            skipped = 0;
+        }
+    }
+
+    priority_mpsc_queue(const priority_mpsc_queue&) = delete;
+    priority_mpsc_queue& operator=(const priority_mpsc_queue&) = delete;
+
+    /**
+     * @brief Pushes an item to lane.
+     *
+     * @details
+     * Will assert if the lane is full if asserts are enabled,
+     * otherwise the behaviour is undefined. The lanes should be dimensioned so that this never happens.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    void push(const size_t lane, U&&... item) noexcept
+    {
+        assert(lane < Lanes);
+        lanes_[lane].push(std::forward<U>(item)...);
+        mark_nonempty(lane);
+    }
+
+    /**
+     * @brief Tries to push an item to lane.
+     *
+     * @details
+     * Returns false without modifying the queue if the lane is full, otherwise pushes the item and returns true.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    bool try_push(const size_t lane, U&&... item) noexcept
+    {
+        assert(lane < Lanes);
+        if (!lanes_[lane].try_push(std::forward<U>(item)...))
+        {
+            return false;
+        }
+        mark_nonempty(lane);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the highest priority lane that holds one, subject to the starvation quantum.
+     *
+     * @details
+     * Returns false if all lanes are empty, otherwise true and the lane the item came from. item and lane are only
+     * valid if the function returns true.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    bool pop(T& item, size_t& lane) noexcept
+    {
+        for (;;)
+        {
+            const auto nonempty = nonempty_.load(std::memory_order_acquire);
+            if (nonempty == 0)
+            {
+                return false;
+            }
+
+            const auto candidate = select(nonempty);
+            if (lanes_[candidate].pop(item))
+            {
+                account(nonempty, candidate);
+                lane = candidate;
+                return true;
+            }
+            clear_nonempty(candidate);
+        }
+    }
+
+    bool pop(T& item) noexcept
+    {
+        size_t lane;
+        return pop(item, lane);
+    }
+
+    /**
+     * @brief Checks if all lanes are empty with a single load.
+     *
+     * @details
+     * A lane that was emptied stays marked until the next pop visits it, so the result can be false for a queue
+     * that holds no items. It is never true for a queue that holds items.
+     *
+     * Thread safe with regards to push and pop operations.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return nonempty_.load(std::memory_order_acquire) == 0;
+    }
+
+    /**
+     * @brief Get the maximum number of elements per lane.
+   */
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+    [[nodiscard]] static constexpr size_t lane_count() noexcept
+    {
+        return Lanes;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+
+    mpsc_queue<T, S, Layout> lanes_[Lanes];
+    alignas(cache_line_size_) std::atomic<uint64_t> nonempty_;
+
+    // Only accessed by the consumer. skipped_ counts how many pops passed over a non empty lane in a row.
+    alignas(cache_line_size_) size_t quantum_;
+    size_t skipped_[Lanes];
+
+    void mark_nonempty(const size_t lane) noexcept
+    {
+        const auto mask = uint64_t(1) << lane;
+        // Orders the push before the load, pairs with the fence in clear_nonempty().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((nonempty_.load(std::memory_order_relaxed) & mask) == 0)
+        {
+            nonempty_.fetch_or(mask, std::memory_order_release);
+        }
+    }
+
+    void clear_nonempty(const size_t lane) noexcept
+    {
+        const auto mask = uint64_t(1) << lane;
+        nonempty_.fetch_and(~mask, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // A producer that saw the bit still set before it was cleared pushed before the fence.
+        if (!lanes_[lane].empty())
+        {
+            nonempty_.fetch_or(mask, std::memory_order_relaxed);
+        }
+        skipped_[lane] = 0;
+    }
+
+    size_t select(const uint64_t nonempty) const noexcept
+    {
+        const auto highest = detail::count_trailing_zeros(nonempty);
+        for (auto others = nonempty & (nonempty - 1); others != 0; others &= others - 1)
+        {
+            const auto lane = detail::count_trailing_zeros(others);
+            if (skipped_[lane] >= quantum_)
+            {
+                return lane;
+            }
+        }
+        return highest;
+    }
+
+    void account(const uint64_t nonempty, const size_t served) noexcept
+    {
+        skipped_[served] = 0;
+        for (auto others = nonempty & ~(uint64_t(1) << served); others != 0; others &= others - 1)
+        {
+            ++skipped_[detail::count_trailing_zeros(others)];
+        }
+    }
+};
+
+}// namespace waitfree
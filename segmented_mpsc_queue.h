@@ -0,0 +1,402 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "allocator.h"
+#include "cache_line.h"
+#include "mpsc_queue.h"
+#include "wait_strategy.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace waitfree
+{
+
+/**
+ * Unbounded, multiple producer, single consumer queue built from a chain of fixed size ring segments.
+ *
+ * Each segment holds S slots, the slot layout is the same as for mpsc_queue. When a segment is full the producer
+ * that notices links a new one, taken from a recycling pool when possible. The consumer returns drained segments to
+ * the pool, so a queue in steady state does not allocate. Segments are never freed while the queue is alive, since a
+ * producer can still hold a pointer to a segment the consumer has drained. The queue keeps the memory of its
+ * largest backlog until it is destroyed.
+ *
+ * Pushing into a segment with free slots costs the same as mpsc_queue::push, a fetch_add on the segment tail and the
+ * release store of the slot. A drained segment keeps its tail at S or above until it is linked again, so a producer
+ * with a stale pointer to it claims nothing and takes the slow path. Linking the next segment and opening it are done
+ * under a spin lock, taken once per S pushes, which makes push wait-free only while the tail segment has free slots.
+ *
+ * T is the type of the elements in the queue.
+ * S is the number of elements per segment. S must be a power of 2.
+ * Layout is the slot layout, padded_layout or packed_layout.
+ * Allocator allocates the segments, see allocator.h.
+ */
+template<typename T, size_t S, typename Layout = padded_layout, typename Allocator = default_allocator>
+class segmented_mpsc_queue
+{
+public:
+    explicit segmented_mpsc_queue(const Allocator& allocator = Allocator())
+        : allocator_(allocator),
+          head_index_(0),
+          spares_(nullptr),
+          linking_(false)
+    {
+        static_assert(is_power_of_two(S) && S != 0);
+        head_segment_ = allocate_segment();
+        if (!head_segment_)
+        {
+            throw std::bad_alloc();
+        }
+        tail_segment_.store(head_segment_, std::memory_order_relaxed);
+    }
+
+    segmented_mpsc_queue(const segmented_mpsc_queue&) = delete;
+    segmented_mpsc_queue& operator=(const segmented_mpsc_queue&) = delete;
+
+    ~segmented_mpsc_queue()
+    {
+        auto index = head_index_;
+        for (auto segment = head_segment_; segment;)
+        {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                for (; index < S; ++index)
+                {
+                    auto& element = segment->elements()[index];
+                    if (element.sequence_.load(std::memory_order_acquire) == 1)
+                    {
+                        (&element.value_)->~T();
+                    }
+                }
+            }
+            index = 0;
+            const auto next = segment->next_.load(std::memory_order_acquire);
+            free_segment(segment);
+            segment = next;
+        }
+
+        for (auto segment = spares_.load(std::memory_order_acquire); segment;)
+        {
+            const auto next = segment->spare_next_;
+            free_segment(segment);
+            segment = next;
+        }
+    }
+
+    /**
+     * @brief Pushes an item to the queue.
+     *
+     * @details
+     * Never fails because the queue is full. Throws std::bad_alloc if a new segment is needed, the pool is empty and
+     * the allocation fails. If the constructor of T throws, the claimed slot is marked for the consumer to skip and
+     * the exception is rethrown.
+     *
+     * Thread safe with regards to other push operations and to pop operations.
+   */
+    template<typename... U>
+    void push(U&&... item)
+    {
+        for (;;)
+        {
+            const auto segment = tail_segment_.load(std::memory_order_acquire);
+            WAITFREE_STRESS_POINT();
+            // Acquire pairs with the store that opened the segment, the consumer is done with the slot before that.
+            const auto index = segment->tail_.fetch_add(1, std::memory_order_acquire);
+            if (index < S)
+            {
+                publish(segment->elements()[index], std::forward<U>(item)...);
+                return;
+            }
+            link_next_segment(segment);
+        }
+    }
+
+    /**
+     * @brief Pops an item from the queue.
+     *
+     * @details
+     * Returns false if the queue is empty, otherwise true. item is only valid if the function returns true.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    bool pop(T& item) noexcept
+    {
+        for (;;)
+        {
+            if (head_index_ == S && !advance_head_segment())
+            {
+                return false;
+            }
+
+            auto& element = head_segment_->elements()[head_index_];
+            const auto sequence = element.sequence_.load(std::memory_order_acquire);
+            if (sequence == 0)
+            {
+                return false;
+            }
+
+            if (sequence == 2)
+            {
+                element.sequence_.store(0, std::memory_order_relaxed);
+                ++head_index_;
+                continue;
+            }
+
+            extract(element.value_, item);
+            element.sequence_.store(0, std::memory_order_relaxed);
+            ++head_index_;
+            return true;
+        }
+    }
+
+    /**
+     * @brief Checks if the queue is empty
+     *
+     * @details
+     * Not thread safe with regards to pop operations, thread safe with regards to push operations. Regarding
+     * thread safety empty() is considered a pop operation.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        const segment* segment = head_segment_;
+        for (auto index = head_index_;; ++index)
+        {
+            if (index == S)
+            {
+                segment = segment->next_.load(std::memory_order_acquire);
+                if (!segment)
+                {
+                    return true;
+                }
+                index = 0;
+            }
+
+            const auto sequence = segment->elements()[index].sequence_.load(std::memory_order_acquire);
+            if (sequence != 2)
+            {
+                return sequence == 0;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+
+    using element = typename Layout::template element<T>;
+
+    /**
+     * Slots follow the segment header. A slot sequence is 0 when free, 1 when it holds an item and 2 when the
+     * constructor of the item threw and the consumer skips the slot.
+     */
+    struct segment
+    {
+        // tail_ keeps counting past S when producers race for the last slots, and stays there until the segment is
+        // linked again.
+        alignas(cache_line_size_) std::atomic<size_t> tail_;
+        alignas(cache_line_size_) std::atomic<segment*> next_;
+        // Links the segment in spares_.
+        segment* spare_next_;
+
+        element* elements() noexcept
+        {
+            return reinterpret_cast<element*>(reinterpret_cast<uint8_t*>(this) + elements_offset_);
+        }
+
+        const element* elements() const noexcept
+        {
+            return reinterpret_cast<const element*>(reinterpret_cast<const uint8_t*>(this) + elements_offset_);
+        }
+    };
+
+    static constexpr size_t segment_alignment_ = std::max(alignof(segment), alignof(element));
+    static constexpr size_t elements_offset_ = (sizeof(segment) + alignof(element) - 1) / alignof(element) * alignof(element);
+    static constexpr size_t segment_size_ = (elements_offset_ + sizeof(element) * S + segment_alignment_ - 1) / segment_alignment_ * segment_alignment_;
+    static constexpr uint32_t max_spins_ = 64;
+
+    Allocator allocator_;
+
+    // Only accessed by the consumer.
+    alignas(cache_line_size_) segment* head_segment_;
+    size_t head_index_;
+
+    // Only written with linking_ held.
+    alignas(cache_line_size_) std::atomic<segment*> tail_segment_;
+    // Stack of drained segments. The consumer pushes, producers pop with linking_ held, which keeps the pop free of
+    // ABA without a tagged pointer.
+    alignas(cache_line_size_) std::atomic<segment*> spares_;
+    std::atomic<bool> linking_;
+
+    segment* allocate_segment()
+    {
+        auto memory = allocator_.allocate(segment_size_, segment_alignment_);
+        if (!memory)
+        {
+            return nullptr;
+        }
+        detail::zero_fill<Allocator>(memory, segment_size_);
+        auto result = new (memory) segment();
+        result->tail_.store(0, std::memory_order_relaxed);
+        result->next_.store(nullptr, std::memory_order_relaxed);
+        result->spare_next_ = nullptr;
+        return result;
+    }
+
+    void free_segment(segment* node) noexcept
+    {
+        node->~segment();
+        allocator_.deallocate(node, segment_size_, segment_alignment_);
+    }
+
+    /**
+     * Links a segment after full if it is still the tail segment and has no free slots, otherwise another producer
+     * got there first and the caller retries. full may be a segment that has been drained, or drained and linked
+     * again, since the caller loaded it.
+     */
+    void link_next_segment(segment* full)
+    {
+        for (uint32_t spins = 0; linking_.exchange(true, std::memory_order_acquire); ++spins)
+        {
+            if (spins < max_spins_)
+            {
+                detail::cpu_relax();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (tail_segment_.load(std::memory_order_relaxed) == full && full->tail_.load(std::memory_order_relaxed) >= S)
+        {
+            const auto next = take_spare();
+            if (!next)
+            {
+                linking_.store(false, std::memory_order_release);
+                throw std::bad_alloc();
+            }
+            next->next_.store(nullptr, std::memory_order_relaxed);
+            full->next_.store(next, std::memory_order_release);
+            tail_segment_.store(next, std::memory_order_release);
+            // Opened last, a producer that still holds next from its previous use only claims slots once it is linked.
+            next->tail_.store(0, std::memory_order_release);
+        }
+        linking_.store(false, std::memory_order_release);
+    }
+
+    /**
+     * Pops a segment from the pool, or allocates one when the pool is empty. Called with linking_ held, so only
+     * pushes run concurrently and head stays in the stack with a valid link until the exchange.
+     */
+    segment* take_spare()
+    {
+        auto head = spares_.load(std::memory_order_acquire);
+        while (head && !spares_.compare_exchange_weak(head, head->spare_next_, std::memory_order_acquire, std::memory_order_acquire))
+        {
+        }
+        return head ? head : allocate_segment();
+    }
+
+    /**
+     * Returns a drained segment to the pool. Its tail and link are left alone, a producer that loaded tail_segment_
+     * before it moved on can still claim from it and must see it full.
+     */
+    void recycle(segment* node) noexcept
+    {
+        auto head = spares_.load(std::memory_order_relaxed);
+        do
+        {
+            node->spare_next_ = head;
+        } while (!spares_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    bool advance_head_segment() noexcept
+    {
+        const auto next = head_segment_->next_.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+
+        recycle(head_segment_);
+        head_segment_ = next;
+        head_index_ = 0;
+        return true;
+    }
+
+    template<typename... U>
+    static void publish(element& slot, U&&... item)
+    {
+        if constexpr (std::is_nothrow_constructible_v<T, U&&...>)
+        {
+            new (&slot.value_) T(std::forward<U>(item)...);
+        }
+        else
+        {
+            try
+            {
+                new (&slot.value_) T(std::forward<U>(item)...);
+            }
+            catch (...)
+            {
+                slot.sequence_.store(2, std::memory_order_release);
+                throw;
+            }
+        }
+        slot.sequence_.store(1, std::memory_order_release);
+    }
+
+    template<typename U>
+    static void extract(T& value, U&& item) noexcept
+    {
+        if constexpr (std::is_move_assignable_v<T>)
+        {
+            item = std::move(value);
+        }
+        else
+        {
+            item = value;
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                (&value)->~T();
+            }
+        }
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+}// namespace waitfree
@@ -0,0 +1,630 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#define WAITFREE_SHM_QUEUE_UNDEF_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define WAITFREE_SHM_QUEUE_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef WAITFREE_SHM_QUEUE_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef WAITFREE_SHM_QUEUE_UNDEF_NOMINMAX
+#endif
+#ifdef WAITFREE_SHM_QUEUE_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef WAITFREE_SHM_QUEUE_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+namespace waitfree
+{
+
+/**
+ * Named shared memory region, shm_open and mmap on POSIX, a pagefile backed file mapping on Windows.
+ *
+ * The creating process should call remove() when the name is no longer needed, open mappings stay valid until they
+ * are destroyed. Throws std::system_error if the region cannot be created, opened or mapped.
+ */
+class shm_region
+{
+public:
+    /**
+     * Creates a new zero filled region of size bytes. Fails if a region with the same name already exists.
+     */
+    static shm_region create(const std::string& name, const size_t size)
+    {
+        return shm_region(name, size, true);
+    }
+
+    /**
+     * Opens and maps an existing region, the size is taken from the region.
+     */
+    static shm_region open(const std::string& name)
+    {
+        return shm_region(name, 0, false);
+    }
+
+    /**
+     * Removes the name of a region. Existing mappings are not affected.
+     */
+    static void remove(const std::string& name) noexcept
+    {
+#ifndef _WIN32
+        shm_unlink(name.c_str());
+#else
+        (void) name;
+#endif
+    }
+
+    shm_region(shm_region&& other) noexcept
+        : data_(other.data_),
+          size_(other.size_)
+#ifdef _WIN32
+          ,
+          handle_(other.handle_)
+#endif
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+#ifdef _WIN32
+        other.handle_ = nullptr;
+#endif
+    }
+
+    shm_region(const shm_region&) = delete;
+    shm_region& operator=(const shm_region&) = delete;
+    shm_region& operator=(shm_region&&) = delete;
+
+    ~shm_region()
+    {
+        if (!data_)
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle(handle_);
+#else
+        munmap(data_, size_);
+#endif
+    }
+
+    [[nodiscard]] void* data() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_;
+    }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE handle_ = nullptr;
+#endif
+
+    shm_region(const std::string& name, const size_t size, const bool create)
+    {
+#ifdef _WIN32
+        if (create)
+        {
+            const auto size_64 = static_cast<uint64_t>(size);
+            handle_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size_64 >> 32), static_cast<DWORD>(size_64), name.c_str());
+            if (handle_ && GetLastError() == ERROR_ALREADY_EXISTS)
+            {
+                CloseHandle(handle_);
+                throw std::system_error(ERROR_ALREADY_EXISTS, std::system_category(), "CreateFileMapping " + name);
+            }
+        }
+        else
+        {
+            handle_ = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+        }
+        if (!handle_)
+        {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "file mapping " + name);
+        }
+
+        data_ = MapViewOfFile(handle_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (!data_)
+        {
+            const auto error = GetLastError();
+            CloseHandle(handle_);
+            throw std::system_error(static_cast<int>(error), std::system_category(), "MapViewOfFile " + name);
+        }
+
+        MEMORY_BASIC_INFORMATION info;
+        VirtualQuery(data_, &info, sizeof(info));
+        size_ = create ? size : static_cast<size_t>(info.RegionSize);
+#else
+        const auto fd = shm_open(name.c_str(), create ? O_CREAT | O_EXCL | O_RDWR : O_RDWR, 0600);
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        }
+
+        size_ = size;
+        if (create)
+        {
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                const auto error = errno;
+                close(fd);
+                shm_unlink(name.c_str());
+                throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+            }
+        }
+        else
+        {
+            struct stat status;
+            if (fstat(fd, &status) != 0)
+            {
+                const auto error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), "fstat " + name);
+            }
+            size_ = static_cast<size_t>(status.st_size);
+        }
+
+        const auto data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const auto error = errno;
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            if (create)
+            {
+                shm_unlink(name.c_str());
+            }
+            throw std::system_error(error, std::generic_category(), "mmap " + name);
+        }
+        data_ = data;
+#endif
+    }
+};
+
+/**
+ * How a shared memory queue treats the memory it is constructed over.
+ * create initializes the header and the slots, attach validates the header written by the creator.
+ */
+enum class shm_mode
+{
+    create,
+    attach
+};
+
+namespace detail
+{
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory queues require lock-free 64 bit atomics");
+
+constexpr uint64_t shm_magic = 0x3155514d48534657;// "WFSHMQU1"
+constexpr uint32_t shm_version = 1;
+// Part of the shared memory layout, fixed so that processes built with a different WAITFREE_CACHE_LINE_SIZE can
+// share a queue.
+constexpr size_t shm_cache_line_size = 64;
+
+enum class shm_kind : uint32_t
+{
+    mpsc = 1,
+    spsc = 2
+};
+
+/**
+ * Start of a shared memory queue. Only fixed width fields and offsets are stored, so processes built by different
+ * compilers can map the region at different addresses. magic_ is written last by the creator.
+ */
+struct shm_control
+{
+    struct header
+    {
+        std::atomic<uint64_t> magic_;
+        uint32_t version_;
+        shm_kind kind_;
+        uint64_t capacity_;
+        uint64_t value_size_;
+        uint64_t slot_size_;
+        uint64_t slot_alignment_;
+        uint64_t slots_offset_;
+    };
+
+    alignas(shm_cache_line_size) header header_;
+    alignas(shm_cache_line_size) std::atomic<uint64_t> head_;
+    alignas(shm_cache_line_size) std::atomic<uint64_t> tail_;
+};
+
+constexpr size_t shm_slots_offset(const size_t slot_alignment)
+{
+    return (sizeof(shm_control) + slot_alignment - 1) / slot_alignment * slot_alignment;
+}
+
+template<typename T, typename Slot>
+Slot* shm_initialize(void* memory, const size_t size, const shm_mode mode, const shm_kind kind, const size_t capacity)
+{
+    const auto slots_offset = shm_slots_offset(alignof(Slot));
+    if (!memory || reinterpret_cast<uintptr_t>(memory) % std::max(alignof(shm_control), alignof(Slot)) != 0)
+    {
+        throw std::invalid_argument("shared memory queue region is not sufficiently aligned");
+    }
+    if (size < slots_offset + sizeof(Slot) * capacity)
+    {
+        throw std::invalid_argument("shared memory queue region is too small");
+    }
+
+    auto control = reinterpret_cast<shm_control*>(memory);
+    if (mode == shm_mode::create)
+    {
+        new (control) shm_control();
+        control->header_.version_ = shm_version;
+        control->header_.kind_ = kind;
+        control->header_.capacity_ = capacity;
+        control->header_.value_size_ = sizeof(T);
+        control->header_.slot_size_ = sizeof(Slot);
+        control->header_.slot_alignment_ = alignof(Slot);
+        control->header_.slots_offset_ = slots_offset;
+        control->head_.store(0, std::memory_order_relaxed);
+        control->tail_.store(0, std::memory_order_relaxed);
+        memset(reinterpret_cast<uint8_t*>(memory) + slots_offset, 0, sizeof(Slot) * capacity);
+        control->header_.magic_.store(shm_magic, std::memory_order_release);
+    }
+    else
+    {
+        const auto& header = control->header_;
+        if (header.magic_.load(std::memory_order_acquire) != shm_magic)
+        {
+            throw std::runtime_error("shared memory queue region is not initialized");
+        }
+        if (header.version_ != shm_version || header.kind_ != kind || header.capacity_ != capacity ||
+                header.value_size_ != sizeof(T) || header.slot_size_ != sizeof(Slot) || header.slot_alignment_ != alignof(Slot) ||
+                header.slots_offset_ != slots_offset)
+        {
+            throw std::runtime_error("shared memory queue region has a different layout");
+        }
+    }
+
+    return reinterpret_cast<Slot*>(reinterpret_cast<uint8_t*>(memory) + control->header_.slots_offset_);
+}
+
+}// namespace detail
+
+/**
+ * Wait-free, multiple producer, single consumer queue in a shared memory region.
+ *
+ * The header, head, tail and slots all live in the region, the object itself only holds process local pointers
+ * into it. Every process constructs its own shm_mpsc_queue over its own mapping of the region. Pushes, pops and the
+ * slot sequence numbers work like mpsc_queue.
+ *
+ * T is the type of the elements in the queue and must be trivially copyable.
+ * S is the maximum number of elements in the queue. S must be a power of 2 and at least 2.
+ */
+template<typename T, size_t S>
+class shm_mpsc_queue
+{
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "shared memory queues require trivially copyable elements");
+
+    /**
+     * Number of bytes the queue needs at the start of the region.
+     */
+    static constexpr size_t required_size()
+    {
+        return detail::shm_slots_offset(alignof(element)) + sizeof(element) * S;
+    }
+
+    /**
+     * Constructs a view of the queue over memory, which must be at least required_size() bytes and cache line
+     * aligned. Throws std::invalid_argument if it is not, and std::runtime_error if mode is attach and the region was
+     * not created by a shm_mpsc_queue with the same T and S.
+     */
+    shm_mpsc_queue(void* memory, const size_t size, const shm_mode mode)
+        : control_(reinterpret_cast<detail::shm_control*>(memory)),
+          elements_(detail::shm_initialize<T, element>(memory, size, mode, detail::shm_kind::mpsc, S))
+    {
+        static_assert(is_power_of_two(S) && S >= 2);
+    }
+
+    /**
+     * @brief Pushes an item to the queue.
+     *
+     * @details
+     * Will assert if the queue is full if asserts are enabled,
+     * otherwise the behaviour is undefined. The queue should be dimensioned so that this never happens.
+     *
+     * Thread and process safe with regards to other push operations and to pop operations.
+   */
+    void push(const T& item) noexcept
+    {
+        const auto tail = control_->tail_.fetch_add(1, std::memory_order_relaxed);
+        auto& element = elements_[tail & mod_value_];
+        assert(element.sequence_.load(std::memory_order_acquire) == lap(tail));
+        element.value_ = item;
+        element.sequence_.store(lap(tail) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Tries to push an item to the queue.
+     *
+     * @details
+     * Returns false without modifying the queue if the queue is full, otherwise pushes the item and returns true.
+     *
+     * Thread and process safe with regards to other push operations and to pop operations.
+   */
+    bool try_push(const T& item) noexcept
+    {
+        auto tail = control_->tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& element = elements_[tail & mod_value_];
+            const auto difference = static_cast<int64_t>(element.sequence_.load(std::memory_order_acquire) - lap(tail));
+            if (difference == 0)
+            {
+                if (control_->tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    element.value_ = item;
+                    element.sequence_.store(lap(tail) + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                tail = control_->tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Pops an item from the queue.
+     *
+     * @details
+     * Returns false if the queue is empty, otherwise true. item is only valid if the function returns true.
+     *
+     * Not thread or process safe with regards to other pop operations, thread and process safe with regards to push
+     * operations.
+   */
+    bool pop(T& item) noexcept
+    {
+        const auto head = control_->head_.load(std::memory_order_relaxed);
+        auto& element = elements_[head & mod_value_];
+        if (element.sequence_.load(std::memory_order_acquire) != lap(head) + 1)
+        {
+            return false;
+        }
+
+        item = element.value_;
+        element.sequence_.store(lap(head) + S, std::memory_order_release);
+        control_->head_.store(head + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Checks if the queue is empty
+     *
+     * @details
+     * Regarding thread safety empty() is considered a pop operation.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        const auto head = control_->head_.load(std::memory_order_relaxed);
+        return elements_[head & mod_value_].sequence_.load(std::memory_order_acquire) != lap(head) + 1;
+    }
+
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+private:
+    static constexpr uint64_t mod_value_ = S - 1;
+
+    struct element
+    {
+        alignas(detail::shm_cache_line_size) T value_;
+        std::atomic<uint64_t> sequence_;
+    };
+
+    detail::shm_control* control_;
+    element* elements_;
+
+    static constexpr uint64_t lap(const uint64_t position)
+    {
+        return position & ~mod_value_;
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+/**
+ * Wait-free, single producer, single consumer queue in a shared memory region.
+ *
+ * head and tail live in the region on separate cache lines. Like spsc_queue_fast each side caches the other side's
+ * index in its own process local queue object.
+ *
+ * T is the type of the elements in the queue and must be trivially copyable.
+ * S is the maximum number of elements in the queue. S must be a power of 2.
+ */
+template<typename T, size_t S>
+class shm_spsc_queue
+{
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "shared memory queues require trivially copyable elements");
+
+    /**
+     * Number of bytes the queue needs at the start of the region.
+     */
+    static constexpr size_t required_size()
+    {
+        return detail::shm_slots_offset(alignof(T)) + sizeof(T) * S;
+    }
+
+    /**
+     * Constructs a view of the queue over memory, see shm_mpsc_queue.
+     */
+    shm_spsc_queue(void* memory, const size_t size, const shm_mode mode)
+        : control_(reinterpret_cast<detail::shm_control*>(memory)),
+          elements_(detail::shm_initialize<T, T>(memory, size, mode, detail::shm_kind::spsc, S)),
+          cached_head_(control_->head_.load(std::memory_order_acquire)),
+          cached_tail_(control_->tail_.load(std::memory_order_acquire))
+    {
+        static_assert(is_power_of_two(S) && S != 0);
+    }
+
+    /**
+     * @brief Pushes an item to the queue.
+     *
+     * @details
+     * Will assert if the queue is full if asserts are enabled,
+     * otherwise the behaviour is undefined. The queue should be dimensioned so that this never happens.
+     *
+     * Not thread or process safe with regards to other push operations, thread and process safe with regards to pop
+     * operations.
+   */
+    void push(const T& item) noexcept
+    {
+        const auto tail = control_->tail_.load(std::memory_order_relaxed);
+        assert(!is_full(tail));
+        elements_[tail & mod_value_] = item;
+        control_->tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Tries to push an item to the queue.
+     *
+     * @details
+     * Returns false without modifying the queue if the queue is full, otherwise pushes the item and returns true.
+   */
+    bool try_push(const T& item) noexcept
+    {
+        const auto tail = control_->tail_.load(std::memory_order_relaxed);
+        if (is_full(tail))
+        {
+            return false;
+        }
+
+        elements_[tail & mod_value_] = item;
+        control_->tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the queue.
+     *
+     * @details
+     * Returns false if the queue is empty, otherwise true. item is only valid if the function returns true.
+     *
+     * Not thread or process safe with regards to other pop operations, thread and process safe with regards to push
+     * operations.
+   */
+    bool pop(T& item) noexcept
+    {
+        const auto head = control_->head_.load(std::memory_order_relaxed);
+        if (cached_tail_ == head)
+        {
+            cached_tail_ = control_->tail_.load(std::memory_order_acquire);
+            if (cached_tail_ == head)
+            {
+                return false;
+            }
+        }
+
+        item = elements_[head & mod_value_];
+        control_->head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Get the current size of the queue.
+     *
+     * Thread and process safe with regards to push and pop operations.
+   */
+    [[nodiscard]] size_t size() const noexcept
+    {
+        const auto head = control_->head_.load(std::memory_order_acquire);
+        const auto tail = control_->tail_.load(std::memory_order_acquire);
+        return static_cast<size_t>(std::min<uint64_t>(tail - head, S));
+    }
+
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+private:
+    static constexpr uint64_t mod_value_ = S - 1;
+
+    detail::shm_control* control_;
+    T* elements_;
+    uint64_t cached_head_;
+    uint64_t cached_tail_;
+
+    bool is_full(const uint64_t tail) noexcept
+    {
+        if (tail - cached_head_ < S)
+        {
+            return false;
+        }
+        cached_head_ = control_->head_.load(std::memory_order_acquire);
+        return tail - cached_head_ >= S;
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+}// namespace waitfree
@@ -24,17 +24,20 @@ SOFTWARE.
 
 #pragma once
 
+#include "allocator.h"
+#include "cache_line.h"
+#include "statistics.h"
+#include "wait_strategy.h"
 #include <atomic>
-#ifdef _WIN32
-#include <malloc.h>
-#endif
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <csignal>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
@@ -46,49 +49,58 @@ namespace waitfree
  * to query queue size.
  *
  * T is the type of the elements in the queue.
- * S is the maximum number of elements in the queue. S must be a power of 2.
+ * S is the maximum number of elements in the queue. S must be a power of 2, or 0 to pass the capacity to the
+ * constructor instead.
+ * Allocator allocates the element buffer, see allocator.h.
+ * WaitStrategy decides how pop_wait waits for items, see wait_strategy.h.
+ * Statistics counts queue events, see statistics.h. The default no_statistics is compiled out.
  */
-template<typename T, size_t S>
+template<typename T, size_t S, typename Allocator = default_allocator, typename WaitStrategy = spin_wait, typename Statistics = no_statistics>
 class spsc_queue
 {
 public:
+    using value_type = T;
+
+    template<size_t N = S, std::enable_if_t<N != 0, int> = 0>
     spsc_queue()
-        : size_(0),
-          head_(0),
-          tail_(0)
+        : spsc_queue(construct_tag(), S, Allocator())
     {
         static_assert(is_power_of_two(S));
-        constexpr auto alignment = std::max(alignof(T), sizeof(void*));
-        constexpr auto adjusted_size = round_up_to_multiple_of(sizeof(T) * S, alignment);
-#ifdef _WIN32
-        auto alloc_result = _aligned_malloc(adjusted_size, alignment);
-#else
-        auto alloc_result = aligned_alloc(alignment, adjusted_size);
-#endif
-        if (!alloc_result)
-        {
-            throw std::bad_alloc();
-        }
-        memset(alloc_result, 0, adjusted_size);
-        elements_ = reinterpret_cast<T*>(alloc_result);
+    }
+
+    /**
+     * Constructs a queue with a static capacity that allocates its buffer from allocator.
+     */
+    template<size_t N = S, std::enable_if_t<N != 0, int> = 0>
+    explicit spsc_queue(const Allocator& allocator)
+        : spsc_queue(construct_tag(), S, allocator)
+    {
+        static_assert(is_power_of_two(S));
+    }
+
+    /**
+     * Constructs a queue with a capacity chosen at runtime, only available when S is 0.
+     * Throws std::invalid_argument if capacity is not a power of 2.
+     */
+    template<size_t N = S, std::enable_if_t<N == 0, int> = 0>
+    explicit spsc_queue(const size_t capacity, const Allocator& allocator = Allocator())
+        : spsc_queue(construct_tag(), capacity, allocator)
+    {
     }
 
     ~spsc_queue()
     {
         if constexpr (!std::is_trivially_destructible_v<T>)
         {
-            const auto size = size_.load();
+            // Items pushed since the last publish are in the buffer too.
+            const auto size = size_.load() + unpublished_;
             for (size_t i = 0; i < size; ++i)
             {
-                const auto head = (head_ + i) & mod_value_;
+                const auto head = (head_ + i) & mod_value();
                 (&elements_[head])->~T();
             }
         }
-#ifdef _WIN32
-        _aligned_free(elements_);
-#else
-        free(elements_);
-#endif
+        allocator_.deallocate(elements_, allocation_size(), alignment_);
     }
 
     /**
@@ -100,10 +112,141 @@ public:
     void push(U&&... item) noexcept
     {
         const auto tail = tail_;
-        tail_ = (tail_ + 1) & mod_value_;
+        tail_ = (tail_ + 1) & mod_value();
         new (&elements_[tail]) T(std::forward<U>(item)...);
-        [[maybe_unused]] const auto oldValue = size_.fetch_add(1, std::memory_order_acq_rel);
-        assert(oldValue < S);
+        publish(1);
+    }
+
+    /**
+     * @brief Tries to push an item to the queue.
+     *
+     * @details
+     * Returns false without modifying the queue if the queue is full, otherwise pushes the item and returns true.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename... U>
+    bool try_push(U&&... item) noexcept
+    {
+        if (size_.load(std::memory_order_acquire) + unpublished_ >= capacity())
+        {
+            count_full();
+            return false;
+        }
+
+        push(std::forward<U>(item)...);
+        return true;
+    }
+
+    /**
+     * @brief Reserves the next slot of the queue for in place production.
+     *
+     * @details
+     * Constructs an item in the slot from item, or default initializes it if no arguments are given, and returns a
+     * pointer to it. The item is not visible to the consumer until commit() is called, and only one slot can be
+     * reserved at a time.
+     * Will assert if the queue is full if asserts are enabled, otherwise the behaviour is undefined.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename... U>
+    [[nodiscard]] T* claim(U&&... item) noexcept
+    {
+        assert(size_.load(std::memory_order_relaxed) + unpublished_ < capacity());
+        return construct(&elements_[tail_], std::forward<U>(item)...);
+    }
+
+    /**
+     * @brief Publishes the item reserved with claim() to the consumer.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    void commit() noexcept
+    {
+        tail_ = (tail_ + 1) & mod_value();
+        publish(1);
+    }
+
+    /**
+     * @brief Pushes the items in the range [first, last) to the queue.
+     *
+     * @details
+     * The items are constructed in the queue in order and published with a single update of the queue size.
+     * When T is trivially copyable and the range is given as pointers the items are copied with at most two memcpy
+     * calls. Will assert if the items do not fit in the queue if asserts are enabled, otherwise the behaviour is
+     * undefined. Returns the number of pushed items.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename InputIt>
+    size_t push_bulk(InputIt first, const InputIt last) noexcept
+    {
+        auto tail = tail_;
+        size_t count = 0;
+        if constexpr (is_contiguous_source_v<InputIt>)
+        {
+            count = static_cast<size_t>(last - first);
+            copy_to_ring(tail, first, count);
+            tail = (tail + count) & mod_value();
+        }
+        else
+        {
+            for (; first != last; ++first, ++count)
+            {
+                new (&elements_[tail]) T(*first);
+                tail = (tail + 1) & mod_value();
+            }
+        }
+
+        tail_ = tail;
+        publish(count);
+        return count;
+    }
+
+    /**
+     * @brief Sets how many pushed items the producer collects before publishing them to the consumer.
+     *
+     * @details
+     * With a batch of 1, the default, every push is published right away. A larger batch publishes items in groups,
+     * with a single update of the queue size, so the consumer fetches whole cache lines of new items at a time and the
+     * size counter changes hands less often, at the cost of latency. A batch of cache_line_size / sizeof(T) items
+     * fills a line per publish. Items still waiting for a publish are not visible to the consumer, call flush() when
+     * the producer goes idle. Will assert if batch is 0 if asserts are enabled.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    void set_publish_batch(const size_t batch) noexcept
+    {
+        assert(batch != 0);
+        publish_batch_ = batch;
+        if (unpublished_ >= publish_batch_)
+        {
+            flush();
+        }
+    }
+
+    /**
+     * @brief Publishes the items pushed since the last publish to the consumer.
+     *
+     * @details
+     * Only needed with a publish batch larger than 1, see set_publish_batch().
+     *
+     * Not thread safe with regards to push operations, thread safe with regards to pop operations.
+   */
+    void flush() noexcept
+    {
+        const auto count = unpublished_;
+        if (count == 0)
+        {
+            return;
+        }
+
+        unpublished_ = 0;
+        WAITFREE_STRESS_POINT();
+        [[maybe_unused]] const auto oldValue = size_.fetch_add(count, std::memory_order_acq_rel);
+        assert(oldValue + count <= capacity());
+        count_push(count, oldValue + count);
+        waiter_.notify();
     }
 
     /**
@@ -118,27 +261,119 @@ public:
     {
         if (size_.load(std::memory_order_acquire) == 0)
         {
+            count_empty();
             return false;
         }
 
         const auto head = head_;
-        head_ = (head_ + 1) & mod_value_;
+        head_ = (head_ + 1) & mod_value();
 
-        if constexpr (std::is_move_assignable_v<T>)
+        extract(elements_[head], item);
+        WAITFREE_STRESS_POINT();
+        size_.fetch_sub(1, std::memory_order_acq_rel);
+        count_pop(1);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the queue, waiting up to timeout for one to be pushed.
+     *
+     * @details
+     * Returns false if the queue is still empty after timeout, otherwise true. item is only valid if the function
+     * returns true. How the consumer waits is decided by WaitStrategy, see wait_strategy.h.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename Rep, typename Period>
+    bool pop_wait(T& item, const std::chrono::duration<Rep, Period>& timeout) noexcept
+    {
+        if (pop(item))
+        {
+            return true;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        return waiter_.wait_until([this]() { return size() != 0; }, deadline) && pop(item);
+    }
+
+    /**
+     * @brief Returns a pointer to the item at the head of the queue without popping it.
+     *
+     * @details
+     * Returns nullptr if the queue is empty. The pointer is valid until the item is popped.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    [[nodiscard]] T* front() noexcept
+    {
+        if (size_.load(std::memory_order_acquire) == 0)
+        {
+            return nullptr;
+        }
+        return &elements_[head_];
+    }
+
+    /**
+     * @brief Pops the item at the head of the queue without copying it out.
+     *
+     * @details
+     * Must only be called after front() returned a non null pointer, which is invalidated by the call. The item is
+     * destroyed in place unless T is trivially destructible.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    void release() noexcept
+    {
+        assert(size_.load(std::memory_order_relaxed) != 0);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            (&elements_[head_])->~T();
+        }
+        head_ = (head_ + 1) & mod_value();
+        size_.fetch_sub(1, std::memory_order_acq_rel);
+        count_pop(1);
+    }
+
+    /**
+     * @brief Pops up to max items from the queue.
+     *
+     * @details
+     * Pops the items at the head of the queue in order and writes them to out. The queue size is only updated once
+     * per call. When T is trivially copyable and out is a pointer the items are copied with at most two memcpy
+     * calls. Returns the number of items written to out.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename OutputIt>
+    size_t pop_bulk(OutputIt out, const size_t max) noexcept
+    {
+        const auto count = std::min(size_.load(std::memory_order_acquire), max);
+        if (count == 0)
+        {
+            count_empty();
+            return 0;
+        }
+
+        auto head = head_;
+        if constexpr (is_contiguous_destination_v<OutputIt>)
         {
-            item = std::move(elements_[head]);
+            copy_from_ring(head, out, count);
+            head = (head + count) & mod_value();
         }
         else
         {
-            item = elements_[head];
-            if constexpr (!std::is_trivially_destructible_v<T>)
+            for (size_t i = 0; i < count; ++i)
             {
-                (&elements_[head])->~T();
+                extract(elements_[head], *out);
+                ++out;
+                head = (head + 1) & mod_value();
             }
         }
 
-        size_.fetch_sub(1, std::memory_order_acq_rel);
-        return true;
+        head_ = head;
+        size_.fetch_sub(count, std::memory_order_acq_rel);
+        count_pop(count);
+        return count;
     }
 
     /**
@@ -151,14 +386,207 @@ public:
         return size_.load(std::memory_order_acquire);
     }
 
+    /**
+     * @brief Faults in every page of the element buffer from the calling thread.
+     *
+     * @details
+     * Useful with an allocator that returns zeroed memory, such as mmap_allocator, to place and warm the buffer on
+     * a thread of the caller's choice instead of the constructing thread. The contents are not changed.
+     *
+     * Must be called before the queue is used, not thread safe with regards to any other operation.
+   */
+    void prefault() noexcept
+    {
+        detail::prefault(elements_, allocation_size());
+    }
+
+    /**
+     * @brief Get the wait strategy, for integrations such as async_pop() in async_queue.h.
+   */
+    [[nodiscard]] WaitStrategy& wait_strategy() noexcept
+    {
+        return waiter_;
+    }
+
+    /**
+     * @brief Get the counters of the Statistics policy, all zero for no_statistics.
+     *
+     * Thread safe with regards to push and pop operations.
+   */
+    [[nodiscard]] statistics_snapshot statistics() const noexcept
+    {
+        return statistics_.snapshot();
+    }
+
+    /**
+     * @brief Get the maximum number of elements in the queue.
+   */
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        if constexpr (S != 0)
+        {
+            return S;
+        }
+        else
+        {
+            return capacity_;
+        }
+    }
+
 private:
-    static constexpr size_t cacheLine_size_ = 64;
-    static constexpr uint32_t mod_value_ = S - 1;
+    static constexpr size_t cacheLine_size_ = cache_line_size;
+    static constexpr size_t alignment_ = std::max(alignof(T), sizeof(void*));
 
     T* elements_;
-    std::atomic<size_t> size_;
+    Allocator allocator_;
+    // Only read when S is 0, the static capacity is a compile time constant.
+    size_t capacity_;
+    // Written by both the producer and the consumer, kept off the lines of the fields they only read.
+    alignas(cacheLine_size_) std::atomic<size_t> size_;
     alignas(cacheLine_size_) size_t head_;
     alignas(cacheLine_size_) size_t tail_;
+    // Producer only, pushed items not yet added to size_.
+    size_t unpublished_;
+    size_t publish_batch_;
+    WaitStrategy waiter_;
+    Statistics statistics_;
+
+    struct construct_tag
+    {
+    };
+
+    spsc_queue(construct_tag, const size_t capacity, const Allocator& allocator)
+        : allocator_(allocator),
+          capacity_(capacity),
+          size_(0),
+          head_(0),
+          tail_(0),
+          unpublished_(0),
+          publish_batch_(1)
+    {
+        if (!is_power_of_two(capacity) || capacity == 0)
+        {
+            throw std::invalid_argument("spsc_queue capacity must be a power of 2");
+        }
+
+        const auto adjusted_size = allocation_size();
+        auto alloc_result = allocator_.allocate(adjusted_size, alignment_);
+        if (!alloc_result)
+        {
+            throw std::bad_alloc();
+        }
+        // Slots are constructed when pushed, the buffer needs no zero state.
+        elements_ = reinterpret_cast<T*>(alloc_result);
+    }
+
+    size_t allocation_size() const noexcept
+    {
+        return round_up_to_multiple_of(sizeof(T) * capacity(), alignment_);
+    }
+
+    size_t mod_value() const noexcept
+    {
+        return capacity() - 1;
+    }
+
+    void count_push(const size_t count, const size_t occupancy) noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_push(count, occupancy, capacity());
+        }
+    }
+
+    void count_full() noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_full();
+        }
+    }
+
+    void count_pop(const size_t count) noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_pop(count);
+        }
+    }
+
+    void count_empty() noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_empty();
+        }
+    }
+
+    void publish(const size_t count) noexcept
+    {
+        unpublished_ += count;
+        assert(size_.load(std::memory_order_relaxed) + unpublished_ <= capacity());
+        if (unpublished_ >= publish_batch_)
+        {
+            flush();
+        }
+    }
+
+    template<typename... U>
+    static T* construct(void* storage, U&&... item)
+    {
+        if constexpr (sizeof...(U) == 0)
+        {
+            return new (storage) T;
+        }
+        else
+        {
+            return new (storage) T(std::forward<U>(item)...);
+        }
+    }
+
+    template<typename It>
+    static constexpr bool is_contiguous_source_v = std::is_trivially_copyable_v<T> &&
+            (std::is_same_v<std::decay_t<It>, T*> || std::is_same_v<std::decay_t<It>, const T*>);
+
+    template<typename It>
+    static constexpr bool is_contiguous_destination_v = std::is_trivially_copyable_v<T> && std::is_same_v<std::decay_t<It>, T*>;
+
+    /**
+     * Copies count items to the ring starting at slot index, in at most two runs split at the end of the buffer.
+     */
+    void copy_to_ring(const size_t index, const T* source, const size_t count) noexcept
+    {
+        const auto first_run = std::min(count, capacity() - index);
+        memcpy(&elements_[index], source, first_run * sizeof(T));
+        memcpy(elements_, source + first_run, (count - first_run) * sizeof(T));
+    }
+
+    /**
+     * Copies count items from the ring starting at slot index, in at most two runs split at the end of the buffer.
+     */
+    void copy_from_ring(const size_t index, T* destination, const size_t count) const noexcept
+    {
+        const auto first_run = std::min(count, capacity() - index);
+        memcpy(destination, &elements_[index], first_run * sizeof(T));
+        memcpy(destination + first_run, elements_, (count - first_run) * sizeof(T));
+    }
+
+    template<typename U>
+    static void extract(T& value, U&& item) noexcept
+    {
+        if constexpr (std::is_move_assignable_v<T>)
+        {
+            item = std::move(value);
+        }
+        else
+        {
+            item = value;
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                (&value)->~T();
+            }
+        }
+    }
 
     static constexpr bool is_power_of_two(const size_t size)
     {
@@ -173,4 +601,10 @@ private:
     }
 };
 
+/**
+ * spsc_queue with the capacity passed to the constructor.
+ */
+template<typename T, typename Allocator = default_allocator, typename WaitStrategy = spin_wait, typename Statistics = no_statistics>
+using spsc_queue_dyn = spsc_queue<T, 0, Allocator, WaitStrategy, Statistics>;
+
 }// namespace waitfree
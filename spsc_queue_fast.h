@@ -0,0 +1,595 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "allocator.h"
+#include "cache_line.h"
+#include "statistics.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace waitfree
+{
+
+/**
+ * Single header, wait-free, single producer, single consumer queue with possibility
+ * to query queue size.
+ *
+ * Unlike spsc_queue there is no counter shared between producer and consumer. The consumer owns head_ and the
+ * producer owns tail_, each on its own cache line, and each side keeps a cached copy of the other side's index
+ * that is only refreshed when the cached view says the queue is empty or full.
+ *
+ * T is the type of the elements in the queue.
+ * S is the maximum number of elements in the queue. S must be a power of 2, or 0 to pass the capacity to the
+ * constructor instead.
+ * Allocator allocates the element buffer, see allocator.h.
+ * WaitStrategy decides how pop_wait waits for items, see wait_strategy.h.
+ * Statistics counts queue events, see statistics.h. The default no_statistics is compiled out.
+ */
+template<typename T, size_t S, typename Allocator = default_allocator, typename WaitStrategy = spin_wait, typename Statistics = no_statistics>
+class spsc_queue_fast
+{
+public:
+    using value_type = T;
+
+    template<size_t N = S, std::enable_if_t<N != 0, int> = 0>
+    spsc_queue_fast()
+        : spsc_queue_fast(construct_tag(), S, Allocator())
+    {
+        static_assert(is_power_of_two(S));
+    }
+
+    /**
+     * Constructs a queue with a static capacity that allocates its buffer from allocator.
+     */
+    template<size_t N = S, std::enable_if_t<N != 0, int> = 0>
+    explicit spsc_queue_fast(const Allocator& allocator)
+        : spsc_queue_fast(construct_tag(), S, allocator)
+    {
+        static_assert(is_power_of_two(S));
+    }
+
+    /**
+     * Constructs a queue with a capacity chosen at runtime, only available when S is 0.
+     * Throws std::invalid_argument if capacity is not a power of 2.
+     */
+    template<size_t N = S, std::enable_if_t<N == 0, int> = 0>
+    explicit spsc_queue_fast(const size_t capacity, const Allocator& allocator = Allocator())
+        : spsc_queue_fast(construct_tag(), capacity, allocator)
+    {
+    }
+
+    ~spsc_queue_fast()
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            const auto tail = tail_.load(std::memory_order_acquire);
+            for (auto head = head_.load(std::memory_order_relaxed); head != tail; ++head)
+            {
+                (&elements_[head & mod_value()])->~T();
+            }
+        }
+        allocator_.deallocate(elements_, allocation_size(), alignment_);
+    }
+
+    /**
+     * @brief Pushes an item to the queue.
+     *
+     * @details
+     * Will assert if the queue is full if asserts are enabled,
+     * otherwise the behaviour is undefined. The queue should be dimensioned so that this never happens.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename... U>
+    void push(U&&... item) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        assert(!is_full(tail));
+        new (&elements_[tail & mod_value()]) T(std::forward<U>(item)...);
+        WAITFREE_STRESS_POINT();
+        tail_.store(tail + 1, std::memory_order_release);
+        count_push(1, tail + 1);
+        waiter_.notify();
+    }
+
+    /**
+     * @brief Tries to push an item to the queue.
+     *
+     * @details
+     * Returns false without modifying the queue if the queue is full, otherwise pushes the item and returns true.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename... U>
+    bool try_push(U&&... item) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (is_full(tail))
+        {
+            count_full();
+            return false;
+        }
+
+        new (&elements_[tail & mod_value()]) T(std::forward<U>(item)...);
+        WAITFREE_STRESS_POINT();
+        tail_.store(tail + 1, std::memory_order_release);
+        count_push(1, tail + 1);
+        waiter_.notify();
+        return true;
+    }
+
+    /**
+     * @brief Reserves the next slot of the queue for in place production.
+     *
+     * @details
+     * Constructs an item in the slot from item, or default initializes it if no arguments are given, and returns a
+     * pointer to it. The item is not visible to the consumer until commit() is called, and only one slot can be
+     * reserved at a time.
+     * Will assert if the queue is full if asserts are enabled, otherwise the behaviour is undefined.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename... U>
+    [[nodiscard]] T* claim(U&&... item) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        assert(!is_full(tail));
+        return construct(&elements_[tail & mod_value()], std::forward<U>(item)...);
+    }
+
+    /**
+     * @brief Publishes the item reserved with claim() to the consumer.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    void commit() noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed) + 1;
+        tail_.store(tail, std::memory_order_release);
+        count_push(1, tail);
+        waiter_.notify();
+    }
+
+    /**
+     * @brief Pushes the items in the range [first, last) to the queue.
+     *
+     * @details
+     * The items are constructed in the queue in order and published with a single store of the tail index.
+     * When T is trivially copyable and the range is given as pointers the items are copied with at most two memcpy
+     * calls. Will assert if the items do not fit in the queue if asserts are enabled, otherwise the behaviour is
+     * undefined. Returns the number of pushed items.
+     *
+     * Not thread safe with regards to other push operations, thread safe with regards to pop operations.
+   */
+    template<typename InputIt>
+    size_t push_bulk(InputIt first, const InputIt last) noexcept
+    {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        size_t count = 0;
+        if constexpr (is_contiguous_source_v<InputIt>)
+        {
+            count = static_cast<size_t>(last - first);
+            assert(count == 0 || !is_full(tail + count - 1));
+            copy_to_ring(tail & mod_value(), first, count);
+        }
+        else
+        {
+            for (; first != last; ++first, ++count)
+            {
+                assert(!is_full(tail + count));
+                new (&elements_[(tail + count) & mod_value()]) T(*first);
+            }
+        }
+
+        tail_.store(tail + count, std::memory_order_release);
+        count_push(count, tail + count);
+        waiter_.notify();
+        return count;
+    }
+
+    /**
+     * @brief Pops an item from the queue.
+     *
+     * @details
+     * Returns false if the queue is empty, otherwise true. item is only valid if the function returns true.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    bool pop(T& item) noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (available(head) == 0)
+        {
+            count_empty();
+            return false;
+        }
+
+        extract(elements_[head & mod_value()], item);
+        WAITFREE_STRESS_POINT();
+        head_.store(head + 1, std::memory_order_release);
+        count_pop(1);
+        return true;
+    }
+
+    /**
+     * @brief Pops an item from the queue, waiting up to timeout for one to be pushed.
+     *
+     * @details
+     * Returns false if the queue is still empty after timeout, otherwise true. item is only valid if the function
+     * returns true. How the consumer waits is decided by WaitStrategy, see wait_strategy.h.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename Rep, typename Period>
+    bool pop_wait(T& item, const std::chrono::duration<Rep, Period>& timeout) noexcept
+    {
+        if (pop(item))
+        {
+            return true;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        return waiter_.wait_until([this]() { return tail_.load(std::memory_order_acquire) != head_.load(std::memory_order_relaxed); }, deadline) && pop(item);
+    }
+
+    /**
+     * @brief Returns a pointer to the item at the head of the queue without popping it.
+     *
+     * @details
+     * Returns nullptr if the queue is empty. The pointer is valid until the item is popped.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    [[nodiscard]] T* front() noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (available(head) == 0)
+        {
+            return nullptr;
+        }
+        return &elements_[head & mod_value()];
+    }
+
+    /**
+     * @brief Pops the item at the head of the queue without copying it out.
+     *
+     * @details
+     * Must only be called after front() returned a non null pointer, which is invalidated by the call. The item is
+     * destroyed in place unless T is trivially destructible.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    void release() noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        assert(cached_tail_ != head);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            (&elements_[head & mod_value()])->~T();
+        }
+        head_.store(head + 1, std::memory_order_release);
+        count_pop(1);
+    }
+
+    /**
+     * @brief Pops up to max items from the queue.
+     *
+     * @details
+     * Pops the items at the head of the queue in order and writes them to out. The head index is only published
+     * once per call. When T is trivially copyable and out is a pointer the items are copied with at most two memcpy
+     * calls. Returns the number of items written to out.
+     *
+     * Not thread safe with regards to other pop operations, thread safe with regards to push operations.
+   */
+    template<typename OutputIt>
+    size_t pop_bulk(OutputIt out, const size_t max) noexcept
+    {
+        const auto head = head_.load(std::memory_order_relaxed);
+        const auto count = std::min(available(head), max);
+        if constexpr (is_contiguous_destination_v<OutputIt>)
+        {
+            copy_from_ring(head & mod_value(), out, count);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                extract(elements_[(head + i) & mod_value()], *out);
+                ++out;
+            }
+        }
+
+        if (count != 0)
+        {
+            head_.store(head + count, std::memory_order_release);
+            count_pop(count);
+        }
+        else
+        {
+            count_empty();
+        }
+        return count;
+    }
+
+    /**
+     * @brief Get the current size of the queue.
+     *
+     * @details
+     * Derived from the head and tail indices, the result is a snapshot that may be stale when the queue is
+     * concurrently modified.
+     *
+     * Thread safe with regards to push and pop operations.
+   */
+    [[nodiscard]] size_t size() const noexcept
+    {
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        return std::min(tail - head, capacity());
+    }
+
+    /**
+     * @brief Faults in every page of the element buffer from the calling thread.
+     *
+     * @details
+     * Useful with an allocator that returns zeroed memory, such as mmap_allocator, to place and warm the buffer on
+     * a thread of the caller's choice instead of the constructing thread. The contents are not changed.
+     *
+     * Must be called before the queue is used, not thread safe with regards to any other operation.
+   */
+    void prefault() noexcept
+    {
+        detail::prefault(elements_, allocation_size());
+    }
+
+    /**
+     * @brief Get the wait strategy, for integrations such as async_pop() in async_queue.h.
+   */
+    [[nodiscard]] WaitStrategy& wait_strategy() noexcept
+    {
+        return waiter_;
+    }
+
+    /**
+     * @brief Get the counters of the Statistics policy, all zero for no_statistics.
+     *
+     * Thread safe with regards to push and pop operations.
+   */
+    [[nodiscard]] statistics_snapshot statistics() const noexcept
+    {
+        return statistics_.snapshot();
+    }
+
+    /**
+     * @brief Get the maximum number of elements in the queue.
+   */
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        if constexpr (S != 0)
+        {
+            return S;
+        }
+        else
+        {
+            return capacity_;
+        }
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+    static constexpr size_t alignment_ = std::max(alignof(T), sizeof(void*));
+
+    alignas(cache_line_size_) T* elements_;
+    Allocator allocator_;
+    // Only read when S is 0, the static capacity is a compile time constant.
+    size_t capacity_;
+
+    // Written by the consumer, cached_tail_ is the consumer's view of tail_.
+    alignas(cache_line_size_) std::atomic<size_t> head_;
+    size_t cached_tail_;
+
+    // Written by the producer, cached_head_ is the producer's view of head_.
+    alignas(cache_line_size_) std::atomic<size_t> tail_;
+    size_t cached_head_;
+
+    WaitStrategy waiter_;
+    Statistics statistics_;
+
+    struct construct_tag
+    {
+    };
+
+    spsc_queue_fast(construct_tag, const size_t capacity, const Allocator& allocator)
+        : allocator_(allocator),
+          capacity_(capacity),
+          head_(0),
+          cached_tail_(0),
+          tail_(0),
+          cached_head_(0)
+    {
+        if (!is_power_of_two(capacity) || capacity == 0)
+        {
+            throw std::invalid_argument("spsc_queue_fast capacity must be a power of 2");
+        }
+
+        const auto adjusted_size = allocation_size();
+        auto alloc_result = allocator_.allocate(adjusted_size, alignment_);
+        if (!alloc_result)
+        {
+            throw std::bad_alloc();
+        }
+        // Slots are constructed when pushed, the buffer needs no zero state.
+        elements_ = reinterpret_cast<T*>(alloc_result);
+    }
+
+    size_t allocation_size() const noexcept
+    {
+        return round_up_to_multiple_of(sizeof(T) * capacity(), alignment_);
+    }
+
+    size_t mod_value() const noexcept
+    {
+        return capacity() - 1;
+    }
+
+    bool is_full(const size_t tail) noexcept
+    {
+        if (tail - cached_head_ < capacity())
+        {
+            return false;
+        }
+        cached_head_ = head_.load(std::memory_order_acquire);
+        return tail - cached_head_ >= capacity();
+    }
+
+    size_t available(const size_t head) noexcept
+    {
+        if (cached_tail_ == head)
+        {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+        }
+        return cached_tail_ - head;
+    }
+
+    void count_push(const size_t count, const size_t end) noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_push(count, end - head_.load(std::memory_order_relaxed), capacity());
+        }
+    }
+
+    void count_full() noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_full();
+        }
+    }
+
+    void count_pop(const size_t count) noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_pop(count);
+        }
+    }
+
+    void count_empty() noexcept
+    {
+        if constexpr (Statistics::enabled)
+        {
+            statistics_.on_empty();
+        }
+    }
+
+    template<typename... U>
+    static T* construct(void* storage, U&&... item)
+    {
+        if constexpr (sizeof...(U) == 0)
+        {
+            return new (storage) T;
+        }
+        else
+        {
+            return new (storage) T(std::forward<U>(item)...);
+        }
+    }
+
+    template<typename It>
+    static constexpr bool is_contiguous_source_v = std::is_trivially_copyable_v<T> &&
+            (std::is_same_v<std::decay_t<It>, T*> || std::is_same_v<std::decay_t<It>, const T*>);
+
+    template<typename It>
+    static constexpr bool is_contiguous_destination_v = std::is_trivially_copyable_v<T> && std::is_same_v<std::decay_t<It>, T*>;
+
+    /**
+     * Copies count items to the ring starting at slot index, in at most two runs split at the end of the buffer.
+     */
+    void copy_to_ring(const size_t index, const T* source, const size_t count) noexcept
+    {
+        const auto first_run = std::min(count, capacity() - index);
+        memcpy(&elements_[index], source, first_run * sizeof(T));
+        memcpy(elements_, source + first_run, (count - first_run) * sizeof(T));
+    }
+
+    /**
+     * Copies count items from the ring starting at slot index, in at most two runs split at the end of the buffer.
+     */
+    void copy_from_ring(const size_t index, T* destination, const size_t count) const noexcept
+    {
+        const auto first_run = std::min(count, capacity() - index);
+        memcpy(destination, &elements_[index], first_run * sizeof(T));
+        memcpy(destination + first_run, elements_, (count - first_run) * sizeof(T));
+    }
+
+    template<typename U>
+    static void extract(T& value, U&& item) noexcept
+    {
+        if constexpr (std::is_move_assignable_v<T>)
+        {
+            item = std::move(value);
+        }
+        else
+        {
+            item = value;
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                (&value)->~T();
+            }
+        }
+    }
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+
+    static constexpr size_t round_up_to_multiple_of(const size_t size, const size_t multiple)
+    {
+        const auto remaining = size % multiple;
+        const auto adjusted_size = remaining == 0 ? size : size + (multiple - remaining);
+        return adjusted_size;
+    }
+};
+
+/**
+ * spsc_queue_fast with the capacity passed to the constructor.
+ */
+template<typename T, typename Allocator = default_allocator, typename WaitStrategy = spin_wait, typename Statistics = no_statistics>
+using spsc_queue_fast_dyn = spsc_queue_fast<T, 0, Allocator, WaitStrategy, Statistics>;
+
+}// namespace waitfree
@@ -0,0 +1,207 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "cache_line.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace waitfree
+{
+
+/**
+ * Statistics policies for the queues.
+ *
+ * A policy declares static constexpr bool enabled. When it is false the queues compile out every call to it,
+ * including computing the occupancy passed to on_push, so no_statistics costs nothing. An enabled policy receives
+ *     void on_push(size_t count, size_t occupancy, size_t capacity);   after count items were pushed
+ *     void on_full();                                                  when try_push finds the queue full
+ *     void on_pop(size_t count);                                       after count items were popped
+ *     void on_empty();                                                 when a pop finds the queue empty
+ * and reports the totals with snapshot(). on_push and on_full are called by producers, on_pop and on_empty by the
+ * consumer.
+ */
+
+/**
+ * Totals reported by a statistics policy. high_water is the highest occupancy seen by a push, near_full counts the
+ * pushes that left the queue at least 7/8 full.
+ */
+struct statistics_snapshot
+{
+    uint64_t pushed = 0;
+    uint64_t popped = 0;
+    uint64_t empty_pops = 0;
+    uint64_t full = 0;
+    uint64_t near_full = 0;
+    uint64_t high_water = 0;
+};
+
+/**
+ * The default, compiled out.
+ */
+struct no_statistics
+{
+    static constexpr bool enabled = false;
+
+    void on_push(size_t, size_t, size_t) noexcept
+    {
+    }
+
+    void on_full() noexcept
+    {
+    }
+
+    void on_pop(size_t) noexcept
+    {
+    }
+
+    void on_empty() noexcept
+    {
+    }
+
+    [[nodiscard]] statistics_snapshot snapshot() const noexcept
+    {
+        return {};
+    }
+};
+
+namespace detail
+{
+
+/**
+ * Index of the calling thread, assigned on first use. Spreads threads over statistics shards.
+ */
+inline size_t thread_index() noexcept
+{
+    static std::atomic<size_t> next{0};
+    thread_local const size_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+}// namespace detail
+
+/**
+ * Counts queue events with relaxed atomics, producer counters sharded over Shards cache lines by thread.
+ *
+ * Producers never write the cache lines of tail_ or head_ for statistics. Threads are assigned shards round robin, so
+ * with no more producer threads than Shards each producer owns its shard. The consumer counters have their own line.
+ * Computing the occupancy for on_push costs mpsc_queue and spsc_queue_fast producers a load of the consumer index.
+ *
+ * Shards is the number of producer shards, a power of 2.
+ */
+template<size_t Shards = 16>
+class queue_statistics
+{
+public:
+    static constexpr bool enabled = true;
+
+    queue_statistics() noexcept
+    {
+        static_assert(Shards != 0 && (Shards & (Shards - 1)) == 0);
+    }
+
+    void on_push(const size_t count, const size_t occupancy, const size_t capacity) noexcept
+    {
+        auto& shard = producer_shard();
+        shard.pushed_.fetch_add(count, std::memory_order_relaxed);
+        if (occupancy * 8 >= capacity * 7)
+        {
+            shard.near_full_.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto high_water = shard.high_water_.load(std::memory_order_relaxed);
+        while (occupancy > high_water &&
+               !shard.high_water_.compare_exchange_weak(high_water, occupancy, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void on_full() noexcept
+    {
+        producer_shard().full_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void on_pop(const size_t count) noexcept
+    {
+        // Single consumer, a load and a store are enough.
+        consumer_.popped_.store(consumer_.popped_.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    void on_empty() noexcept
+    {
+        consumer_.empty_pops_.store(consumer_.empty_pops_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sums the counters.
+     *
+     * @details
+     * Thread safe with regards to all queue operations, the result is a snapshot when the queue is concurrently
+     * modified.
+   */
+    [[nodiscard]] statistics_snapshot snapshot() const noexcept
+    {
+        statistics_snapshot result;
+        for (const auto& shard : shards_)
+        {
+            result.pushed += shard.pushed_.load(std::memory_order_relaxed);
+            result.full += shard.full_.load(std::memory_order_relaxed);
+            result.near_full += shard.near_full_.load(std::memory_order_relaxed);
+            result.high_water = std::max<uint64_t>(result.high_water, shard.high_water_.load(std::memory_order_relaxed));
+        }
+        result.popped = consumer_.popped_.load(std::memory_order_relaxed);
+        result.empty_pops = consumer_.empty_pops_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+
+    struct alignas(cache_line_size_) producer_counters
+    {
+        std::atomic<uint64_t> pushed_{0};
+        std::atomic<uint64_t> full_{0};
+        std::atomic<uint64_t> near_full_{0};
+        std::atomic<size_t> high_water_{0};
+    };
+
+    struct alignas(cache_line_size_) consumer_counters
+    {
+        std::atomic<uint64_t> popped_{0};
+        std::atomic<uint64_t> empty_pops_{0};
+    };
+
+    producer_counters shards_[Shards];
+    consumer_counters consumer_;
+
+    producer_counters& producer_shard() noexcept
+    {
+        return shards_[detail::thread_index() & (Shards - 1)];
+    }
+};
+
+}// namespace waitfree
@@ -0,0 +1,102 @@
+#include "allocator.h"
+#include "mpsc_queue.h"
+#include "spsc_queue.h"
+#include "spsc_queue_fast.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+
+namespace
+{
+
+template<typename Q>
+void push_pop(Q& queue)
+{
+    for (size_t iteration = 0; iteration < 4; ++iteration)
+    {
+        for (uint64_t i = 0; i < queue.capacity(); ++i)
+        {
+            EXPECT_TRUE(queue.try_push(i));
+        }
+        EXPECT_FALSE(queue.try_push(uint64_t(0)));
+
+        for (uint64_t i = 0; i < queue.capacity(); ++i)
+        {
+            uint64_t result;
+            EXPECT_TRUE(queue.pop(result));
+            EXPECT_EQ(i, result);
+        }
+    }
+}
+
+}// namespace
+
+TEST(test_allocator, huge_page_allocator)
+{
+    constexpr size_t size = 3 * 1024 * 1024;
+    waitfree::huge_page_allocator allocator;
+    auto pointer = allocator.allocate(size, 64);
+    ASSERT_NE(nullptr, pointer);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pointer) % 64);
+    memset(pointer, 0xff, size);
+    allocator.deallocate(pointer, size, 64);
+
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 65536, waitfree::padded_layout, waitfree::huge_page_allocator>>();
+    push_pop(*queue);
+}
+
+TEST(test_allocator, numa_allocator)
+{
+#ifdef __linux__
+    waitfree::numa_allocator invalid_node(-1);
+    EXPECT_EQ(nullptr, invalid_node.allocate(4096, 64));
+#endif
+
+    waitfree::numa_allocator allocator(0);
+    auto queue = std::make_unique<waitfree::spsc_queue_fast<uint64_t, 1024, waitfree::numa_allocator>>(allocator);
+    push_pop(*queue);
+}
+
+TEST(test_allocator, arena_allocator)
+{
+    alignas(64) static uint8_t buffer[4096];
+    waitfree::memory_arena arena(buffer, sizeof(buffer));
+    waitfree::arena_allocator allocator(arena);
+
+    auto queue_0 = std::make_unique<waitfree::spsc_queue<uint64_t, 128, waitfree::arena_allocator>>(allocator);
+    auto queue_1 = std::make_unique<waitfree::mpsc_queue_dyn<uint64_t, waitfree::packed_layout, waitfree::arena_allocator>>(128, allocator);
+    EXPECT_THROW((waitfree::spsc_queue<uint64_t, 256, waitfree::arena_allocator>(allocator)), std::bad_alloc);
+
+    push_pop(*queue_0);
+    push_pop(*queue_1);
+}
+
+TEST(test_allocator, mmap_allocator)
+{
+    static_assert(waitfree::detail::allocates_zeroed_memory_v<waitfree::mmap_allocator>);
+    static_assert(!waitfree::detail::allocates_zeroed_memory_v<waitfree::default_allocator>);
+    static_assert(!waitfree::detail::allocates_zeroed_memory_v<waitfree::arena_allocator>);
+
+    constexpr size_t size = 1024 * 1024;
+    for (const auto populate : {false, true})
+    {
+        waitfree::mmap_allocator allocator(populate);
+        auto pointer = reinterpret_cast<uint8_t*>(allocator.allocate(size, 128));
+        ASSERT_NE(nullptr, pointer);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(pointer) % 128);
+        for (size_t offset = 0; offset < size; offset += 4093)
+        {
+            EXPECT_EQ(0, pointer[offset]);
+        }
+        allocator.deallocate(pointer, size, 128);
+    }
+
+    auto queue_0 = std::make_unique<waitfree::mpsc_queue<uint64_t, 65536, waitfree::padded_layout, waitfree::mmap_allocator>>();
+    auto queue_1 = std::make_unique<waitfree::spsc_queue<uint64_t, 65536, waitfree::mmap_allocator>>(waitfree::mmap_allocator(true));
+    std::thread([&queue_0]() { queue_0->prefault(); }).join();
+    push_pop(*queue_0);
+    push_pop(*queue_1);
+}
@@ -0,0 +1,260 @@
+#include "async_queue.h"
+#include "mpsc_queue.h"
+#include "spsc_queue.h"
+#include "spsc_queue_fast.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr uint64_t num_elements = 65536;
+
+/**
+ * Single threaded executor, run() resumes posted coroutines on the calling thread until stopped.
+ */
+class run_queue
+{
+public:
+    void post(const std::coroutine_handle<> handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handles_.push_back(handle);
+    }
+
+    void run(const std::atomic<bool>& done)
+    {
+        while (!done.load(std::memory_order_acquire))
+        {
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!handles_.empty())
+                {
+                    handle = handles_.front();
+                    handles_.pop_front();
+                }
+            }
+            if (handle)
+            {
+                handle.resume();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<std::coroutine_handle<>> handles_;
+};
+
+struct post_to
+{
+    run_queue* executor_;
+
+    void operator()(const std::coroutine_handle<> handle) const
+    {
+        executor_->post(handle);
+    }
+};
+
+/**
+ * Fire and forget coroutine, started eagerly.
+ */
+struct detached
+{
+    struct promise_type
+    {
+        detached get_return_object() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+            std::terminate();
+        }
+    };
+};
+
+template<typename Queue>
+detached consume(Queue& queue, const uint64_t count, std::vector<uint64_t>& results, std::atomic<bool>& done)
+{
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        results.push_back(co_await waitfree::async_pop(queue));
+    }
+    done.store(true, std::memory_order_release);
+}
+
+template<typename Queue, typename Schedule>
+detached consume(Queue& queue, const uint64_t count, Schedule schedule, std::vector<uint64_t>& results, std::atomic<bool>& done)
+{
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        results.push_back(co_await waitfree::async_pop(queue, schedule));
+    }
+    done.store(true, std::memory_order_release);
+}
+
+template<typename Queue>
+void check_resume_inline(Queue& queue)
+{
+    std::vector<uint64_t> results;
+    std::atomic<bool> done{false};
+
+    queue.push(uint64_t(0));
+    consume(queue, 4, results, done);
+    // The first item was ready, the coroutine is now suspended on the empty queue.
+    ASSERT_EQ(1u, results.size());
+
+    // Each push resumes the consumer inline.
+    queue.push(uint64_t(1));
+    ASSERT_EQ(2u, results.size());
+    queue.push(uint64_t(2));
+    queue.push(uint64_t(3));
+    EXPECT_TRUE(done.load());
+    ASSERT_EQ(4u, results.size());
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(i, results[i]);
+    }
+}
+
+}// namespace
+
+TEST(test_async_queue, mpsc_queue_resume_inline)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16, waitfree::padded_layout, waitfree::default_allocator, waitfree::coroutine_wait<>>>();
+    check_resume_inline(*queue);
+}
+
+TEST(test_async_queue, spsc_queue_resume_inline)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16, waitfree::default_allocator, waitfree::coroutine_wait<>>>();
+    check_resume_inline(*queue);
+}
+
+TEST(test_async_queue, spsc_queue_fast_resume_inline)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue_fast<uint64_t, 16, waitfree::default_allocator, waitfree::coroutine_wait<>>>();
+    check_resume_inline(*queue);
+}
+
+TEST(test_async_queue, pop_wait)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16, waitfree::default_allocator, waitfree::coroutine_wait<>>>();
+    uint64_t result;
+    EXPECT_FALSE(queue->pop_wait(result, std::chrono::milliseconds(1)));
+    queue->push(uint64_t(1));
+    EXPECT_TRUE(queue->pop_wait(result, std::chrono::milliseconds(1)));
+    EXPECT_EQ(1u, result);
+}
+
+TEST(test_async_queue, multi_thread_mpsc_queue_executor)
+{
+    static constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 1024, waitfree::padded_layout, waitfree::default_allocator, waitfree::coroutine_wait<>>>();
+    run_queue executor;
+    std::vector<uint64_t> results;
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> producers;
+    for (uint64_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        producers.emplace_back([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                while (!queue->try_push((thread_id << 32) | i))
+                {
+                    std::this_thread::yield();
+                }
+                if ((i & 255) == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::thread consumer([&]() {
+        consume(*queue, num_elements * num_threads, post_to{&executor}, results, done);
+        executor.run(done);
+    });
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    consumer.join();
+
+    ASSERT_EQ(num_elements * num_threads, results.size());
+    uint64_t next[num_threads] = {};
+    for (const auto result : results)
+    {
+        const auto thread_id = result >> 32;
+        ASSERT_LT(thread_id, num_threads);
+        ASSERT_EQ(next[thread_id]++, result & 0xffffffff);
+    }
+}
+
+TEST(test_async_queue, multi_thread_spsc_queue_executor)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 1024, waitfree::default_allocator, waitfree::coroutine_wait<>>>();
+    run_queue executor;
+    std::vector<uint64_t> results;
+    std::atomic<bool> done{false};
+
+    std::thread producer([&queue]() {
+        for (uint64_t i = 0; i < num_elements; ++i)
+        {
+            while (!queue->try_push(i))
+            {
+                std::this_thread::yield();
+            }
+            if ((i & 255) == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&]() {
+        consume(*queue, num_elements, post_to{&executor}, results, done);
+        executor.run(done);
+    });
+
+    producer.join();
+    consumer.join();
+
+    ASSERT_EQ(num_elements, results.size());
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        ASSERT_EQ(i, results[i]);
+    }
+}
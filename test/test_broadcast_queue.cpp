@@ -0,0 +1,145 @@
+#include "broadcast_queue.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+
+}// namespace
+
+TEST(test_broadcast_queue, every_reader_sees_every_item)
+{
+    auto queue = std::make_unique<waitfree::broadcast_queue<uint64_t, 16, 3>>();
+    EXPECT_EQ(nullptr, queue->front(0));
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        queue->push(i);
+    }
+
+    for (size_t reader = 0; reader < 3; ++reader)
+    {
+        EXPECT_EQ(8u, queue->size(reader));
+    }
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        uint64_t result;
+        ASSERT_TRUE(queue->pop(0, result));
+        EXPECT_EQ(i, result);
+    }
+    EXPECT_EQ(0u, queue->size(0));
+    EXPECT_EQ(nullptr, queue->front(0));
+
+    const auto item = queue->front(1);
+    ASSERT_NE(nullptr, item);
+    EXPECT_EQ(0u, *item);
+    EXPECT_EQ(item, queue->front(1));
+    queue->release(1);
+    EXPECT_EQ(1u, *queue->front(1));
+    EXPECT_EQ(8u, queue->size(2));
+}
+
+TEST(test_broadcast_queue, try_push_full_waits_for_slowest_reader)
+{
+    auto queue = std::make_unique<waitfree::broadcast_queue<uint64_t, 4, 2>>();
+
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue->try_push(i));
+    }
+    EXPECT_FALSE(queue->try_push(4));
+
+    uint64_t result;
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue->pop(0, result));
+    }
+    EXPECT_FALSE(queue->try_push(4));
+
+    EXPECT_TRUE(queue->pop(1, result));
+    EXPECT_EQ(0u, result);
+    EXPECT_TRUE(queue->try_push(4));
+    EXPECT_FALSE(queue->try_push(5));
+
+    EXPECT_TRUE(queue->pop(0, result));
+    EXPECT_EQ(4u, result);
+}
+
+TEST(test_broadcast_queue, destroys_items_once)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        waitfree::broadcast_queue<std::shared_ptr<int>, 4, 2> queue;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            queue.push(value);
+        }
+        EXPECT_EQ(5, value.use_count());
+
+        for (size_t reader = 0; reader < 2; ++reader)
+        {
+            ASSERT_NE(nullptr, queue.front(reader));
+            queue.release(reader);
+        }
+        // The released item is only destroyed when its slot is reused.
+        EXPECT_EQ(5, value.use_count());
+        queue.push(value);
+        EXPECT_EQ(5, value.use_count());
+    }
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(test_broadcast_queue, multi_thread_push_read_correctness)
+{
+    static constexpr size_t num_readers = 3;
+    auto queue = std::make_unique<waitfree::broadcast_queue<uint64_t, 1024, num_readers>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    std::vector<size_t> mismatches(num_readers, 0);
+    for (size_t reader = 0; reader < num_readers; ++reader)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, &mismatches, reader]() {
+            for (uint64_t i = 0; i < num_elements;)
+            {
+                const auto item = queue->front(reader);
+                if (!item)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (*item != i)
+                {
+                    ++mismatches[reader];
+                }
+                queue->release(reader);
+                ++i;
+            }
+        }));
+    }
+
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        while (!queue->try_push(i))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+
+    for (size_t reader = 0; reader < num_readers; ++reader)
+    {
+        EXPECT_EQ(0u, mismatches[reader]);
+        EXPECT_EQ(0u, queue->size(reader));
+    }
+}
@@ -0,0 +1,311 @@
+#include "byte_ring.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_messages = 65536;
+
+// Message i is i % 200 bytes long, every byte holds the low bits of i.
+size_t message_size(const uint64_t i)
+{
+    return static_cast<size_t>(i % 200);
+}
+
+void fill_message(std::byte* data, const uint64_t i)
+{
+    std::memset(data, static_cast<int>(i & 0xff), message_size(i));
+}
+
+bool check_message(const waitfree::byte_span& message, const uint64_t i)
+{
+    if (message.size() != message_size(i))
+    {
+        return false;
+    }
+    for (const auto byte : message)
+    {
+        if (byte != static_cast<std::byte>(i & 0xff))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Ring>
+void check_push_read_release(Ring& ring)
+{
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.read().empty());
+
+    const char hello[] = "hello";
+    EXPECT_TRUE(ring.push(hello, sizeof(hello)));
+    EXPECT_TRUE(ring.push(nullptr, 0));
+    auto reserved = ring.reserve(100);
+    ASSERT_FALSE(reserved.empty());
+    EXPECT_EQ(100u, reserved.size());
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(reserved.data()) % 8);
+    std::memcpy(reserved.data(), "abc", 3);
+    ring.commit(reserved, 3);
+    EXPECT_FALSE(ring.empty());
+
+    auto message = ring.read();
+    ASSERT_FALSE(message.empty());
+    ASSERT_EQ(sizeof(hello), message.size());
+    EXPECT_EQ(0, std::memcmp(hello, message.data(), sizeof(hello)));
+    ring.release();
+
+    message = ring.read();
+    ASSERT_FALSE(message.empty());
+    EXPECT_EQ(0u, message.size());
+    ring.release();
+
+    message = ring.read();
+    ASSERT_FALSE(message.empty());
+    ASSERT_EQ(3u, message.size());
+    EXPECT_EQ(0, std::memcmp("abc", message.data(), 3));
+    ring.release();
+
+    EXPECT_TRUE(ring.empty());
+    EXPECT_TRUE(ring.read().empty());
+}
+
+template<typename Ring>
+void check_wrap_around(Ring& ring)
+{
+    // Sizes that do not divide the buffer, so records regularly need a padding record at the end.
+    uint64_t next_push = 0;
+    uint64_t next_pop = 0;
+    for (size_t iteration = 0; iteration < 64; ++iteration)
+    {
+        for (;;)
+        {
+            auto reserved = ring.reserve(message_size(next_push));
+            if (reserved.empty())
+            {
+                break;
+            }
+            fill_message(reserved.data(), next_push++);
+            ring.commit(reserved);
+        }
+        EXPECT_GT(next_push, next_pop);
+
+        for (auto message = ring.read(); !message.empty(); message = ring.read())
+        {
+            ASSERT_TRUE(check_message(message, next_pop++));
+            ring.release();
+            if (next_pop % 3 == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    for (auto message = ring.read(); !message.empty(); message = ring.read())
+    {
+        ASSERT_TRUE(check_message(message, next_pop++));
+        ring.release();
+    }
+    EXPECT_EQ(next_push, next_pop);
+    EXPECT_TRUE(ring.empty());
+}
+
+template<typename Ring>
+void check_max_message_size(Ring& ring)
+{
+    EXPECT_TRUE(ring.reserve(ring.max_message_size() + 1).empty());
+
+    // Leave the head at an odd offset so the largest message needs a padding record.
+    EXPECT_TRUE(ring.push("x", 1));
+    EXPECT_EQ(1u, ring.read().size());
+    ring.release();
+    for (size_t i = 0; i < 4; ++i)
+    {
+        auto reserved = ring.reserve(ring.max_message_size());
+        ASSERT_FALSE(reserved.empty());
+        ring.commit(reserved);
+        EXPECT_FALSE(ring.read().empty());
+        ring.release();
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+template<typename Ring>
+void check_full(Ring& ring)
+{
+    // An 8 byte header and 56 bytes per message, 16 messages fill 1024 bytes.
+    for (size_t i = 0; i < 16; ++i)
+    {
+        auto reserved = ring.reserve(56);
+        ASSERT_FALSE(reserved.empty());
+        ring.commit(reserved);
+    }
+    EXPECT_TRUE(ring.reserve(0).empty());
+    EXPECT_FALSE(ring.push("x", 1));
+
+    EXPECT_EQ(56u, ring.read().size());
+    ring.release();
+    EXPECT_TRUE(ring.reserve(57).empty());
+    EXPECT_FALSE(ring.reserve(56).empty());
+}
+
+}// namespace
+
+TEST(test_byte_ring, spsc_push_read_release)
+{
+    auto ring = std::make_unique<waitfree::spsc_byte_ring<1024>>();
+    check_push_read_release(*ring);
+}
+
+TEST(test_byte_ring, mpsc_push_read_release)
+{
+    auto ring = std::make_unique<waitfree::mpsc_byte_ring<1024>>();
+    check_push_read_release(*ring);
+}
+
+TEST(test_byte_ring, spsc_wrap_around)
+{
+    auto ring = std::make_unique<waitfree::spsc_byte_ring<4096>>();
+    check_wrap_around(*ring);
+}
+
+TEST(test_byte_ring, mpsc_wrap_around)
+{
+    auto ring = std::make_unique<waitfree::mpsc_byte_ring<4096>>();
+    check_wrap_around(*ring);
+}
+
+TEST(test_byte_ring, spsc_max_message_size)
+{
+    auto ring = std::make_unique<waitfree::spsc_byte_ring<1024>>();
+    EXPECT_EQ(504u, ring->max_message_size());
+    check_max_message_size(*ring);
+}
+
+TEST(test_byte_ring, mpsc_max_message_size)
+{
+    auto ring = std::make_unique<waitfree::mpsc_byte_ring<1024>>();
+    check_max_message_size(*ring);
+}
+
+TEST(test_byte_ring, spsc_full)
+{
+    auto ring = std::make_unique<waitfree::spsc_byte_ring<1024>>();
+    check_full(*ring);
+}
+
+TEST(test_byte_ring, mpsc_full)
+{
+    auto ring = std::make_unique<waitfree::mpsc_byte_ring<1024>>();
+    check_full(*ring);
+}
+
+TEST(test_byte_ring, mpsc_uncommitted_holds_back)
+{
+    auto ring = std::make_unique<waitfree::mpsc_byte_ring<1024>>();
+
+    auto first = ring->reserve(8);
+    auto second = ring->reserve(16);
+    ASSERT_FALSE(first.empty());
+    ASSERT_FALSE(second.empty());
+    ring->commit(second);
+    EXPECT_TRUE(ring->empty());
+    EXPECT_TRUE(ring->read().empty());
+
+    ring->commit(first, 4);
+    EXPECT_EQ(4u, ring->read().size());
+    ring->release();
+    EXPECT_EQ(16u, ring->read().size());
+    ring->release();
+    EXPECT_TRUE(ring->empty());
+}
+
+TEST(test_byte_ring, spsc_multi_thread_correctness)
+{
+    auto ring = std::make_unique<waitfree::spsc_byte_ring<4096>>();
+
+    std::thread producer([&ring]() {
+        for (uint64_t i = 0; i < num_messages; ++i)
+        {
+            auto reserved = ring->reserve(message_size(i));
+            while (reserved.empty())
+            {
+                std::this_thread::yield();
+                reserved = ring->reserve(message_size(i));
+            }
+            fill_message(reserved.data(), i);
+            ring->commit(reserved);
+        }
+    });
+
+    for (uint64_t i = 0; i < num_messages; ++i)
+    {
+        auto message = ring->read();
+        while (message.empty())
+        {
+            std::this_thread::yield();
+            message = ring->read();
+        }
+        ASSERT_TRUE(check_message(message, i));
+        ring->release();
+    }
+    producer.join();
+    EXPECT_TRUE(ring->empty());
+}
+
+TEST(test_byte_ring, mpsc_multi_thread_correctness)
+{
+    static constexpr size_t num_threads = 3;
+    auto ring = std::make_unique<waitfree::mpsc_byte_ring<4096>>();
+
+    // Each message carries its producer in the first 8 bytes, followed by i % 200 bytes of the low bits of i.
+    std::vector<std::thread> producers;
+    for (uint64_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        producers.emplace_back([&ring, thread_id]() {
+            for (uint64_t i = 0; i < num_messages; ++i)
+            {
+                auto reserved = ring->reserve(sizeof(uint64_t) + message_size(i));
+                while (reserved.empty())
+                {
+                    std::this_thread::yield();
+                    reserved = ring->reserve(sizeof(uint64_t) + message_size(i));
+                }
+                std::memcpy(reserved.data(), &thread_id, sizeof(thread_id));
+                fill_message(reserved.data() + sizeof(uint64_t), i);
+                ring->commit(reserved);
+            }
+        });
+    }
+
+    uint64_t next[num_threads] = {};
+    for (size_t count = 0; count < num_messages * num_threads; ++count)
+    {
+        auto message = ring->read();
+        while (message.empty())
+        {
+            std::this_thread::yield();
+            message = ring->read();
+        }
+        uint64_t thread_id;
+        ASSERT_GE(message.size(), sizeof(thread_id));
+        std::memcpy(&thread_id, message.data(), sizeof(thread_id));
+        ASSERT_LT(thread_id, num_threads);
+        const waitfree::byte_span payload(message.data() + sizeof(uint64_t), message.size() - sizeof(uint64_t));
+        ASSERT_TRUE(check_message(payload, next[thread_id]++));
+        ring->release();
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    EXPECT_TRUE(ring->empty());
+}
@@ -0,0 +1,155 @@
+#include "event_wait.h"
+#include "mpsc_queue.h"
+#include "spsc_queue.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <poll.h>
+#endif
+
+namespace
+{
+
+constexpr uint64_t num_elements = 65536;
+
+#if !defined(_WIN32)
+bool is_signaled(const waitfree::event_wait& waiter)
+{
+    pollfd descriptor{waiter.native_handle(), POLLIN, 0};
+    return poll(&descriptor, 1, 0) == 1 && (descriptor.revents & POLLIN) != 0;
+}
+#endif
+
+}// namespace
+
+#if !defined(_WIN32)
+TEST(test_event_wait, signal_once_per_arm)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16, waitfree::default_allocator, waitfree::event_wait>>();
+    auto& waiter = queue->wait_strategy();
+
+    // Producers only signal an armed handle.
+    queue->push(uint64_t(0));
+    EXPECT_FALSE(is_signaled(waiter));
+
+    uint64_t result;
+    EXPECT_TRUE(queue->pop(result));
+    waiter.arm();
+    queue->push(uint64_t(1));
+    EXPECT_TRUE(is_signaled(waiter));
+    queue->push(uint64_t(2));
+    waiter.clear();
+    EXPECT_FALSE(is_signaled(waiter));
+
+    // The rest of the burst did not signal again.
+    queue->push(uint64_t(3));
+    EXPECT_FALSE(is_signaled(waiter));
+
+    waiter.arm();
+    waiter.disarm();
+    queue->push(uint64_t(4));
+    EXPECT_FALSE(is_signaled(waiter));
+}
+
+TEST(test_event_wait, multi_thread_poll_loop)
+{
+    static constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 1024, waitfree::padded_layout, waitfree::default_allocator, waitfree::event_wait>>();
+    auto& waiter = queue->wait_strategy();
+
+    std::vector<std::thread> producers;
+    for (uint64_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        producers.emplace_back([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                while (!queue->try_push((thread_id << 32) | i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    uint64_t next[num_threads] = {};
+    size_t count = 0;
+    size_t waits = 0;
+    while (count < num_elements * num_threads)
+    {
+        uint64_t result;
+        while (queue->pop(result))
+        {
+            const auto thread_id = result >> 32;
+            ASSERT_LT(thread_id, num_threads);
+            ASSERT_EQ(next[thread_id]++, result & 0xffffffff);
+            ++count;
+        }
+        if (count == num_elements * num_threads)
+        {
+            break;
+        }
+
+        waiter.arm();
+        if (!queue->empty())
+        {
+            continue;
+        }
+        pollfd descriptor{waiter.native_handle(), POLLIN, 0};
+        ASSERT_EQ(1, poll(&descriptor, 1, 10000));
+        waiter.clear();
+        ++waits;
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    EXPECT_LT(waits, count);
+}
+#endif
+
+TEST(test_event_wait, pop_wait)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16, waitfree::default_allocator, waitfree::event_wait>>();
+
+    uint64_t result;
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(queue->pop_wait(result, std::chrono::milliseconds(5)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(5));
+
+    std::thread producer([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        queue->push(uint64_t(1));
+    });
+    EXPECT_TRUE(queue->pop_wait(result, std::chrono::seconds(10)));
+    EXPECT_EQ(1u, result);
+    producer.join();
+}
+
+TEST(test_event_wait, multi_thread_pop_wait)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 64, waitfree::default_allocator, waitfree::event_wait>>();
+
+    std::thread producer([&queue]() {
+        for (uint64_t i = 0; i < num_elements; ++i)
+        {
+            while (!queue->try_push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        uint64_t result;
+        ASSERT_TRUE(queue->pop_wait(result, std::chrono::seconds(10)));
+        ASSERT_EQ(i, result);
+    }
+    producer.join();
+}
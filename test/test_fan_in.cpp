@@ -0,0 +1,139 @@
+#include "fan_in.h"
+#include "mpsc_queue.h"
+#include "spsc_queue.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_queues = 200;
+constexpr size_t num_elements = 4096;
+
+constexpr uint64_t make_value(const uint64_t queue_id, const uint64_t element_id)
+{
+    return (queue_id << 32) | element_id;
+}
+
+}// namespace
+
+TEST(test_fan_in, ready_bitmap_set_take)
+{
+    waitfree::ready_bitmap<num_queues> ready;
+    EXPECT_EQ(4u, ready.word_count);
+    EXPECT_EQ(0u, ready.count());
+
+    ready.set(3);
+    ready.set(3);
+    ready.set(64);
+    ready.set(199);
+    EXPECT_EQ(3u, ready.count());
+
+    EXPECT_EQ(uint64_t(1) << 3, ready.take(0));
+    EXPECT_EQ(uint64_t(1), ready.take(1));
+    EXPECT_EQ(0u, ready.take(2));
+    EXPECT_EQ(uint64_t(1) << (199 - 192), ready.take(3));
+    EXPECT_EQ(0u, ready.count());
+    EXPECT_EQ(0u, ready.take(0));
+}
+
+TEST(test_fan_in, pop_visits_ready_queues_round_robin)
+{
+    auto queues = std::make_unique<waitfree::fan_in<waitfree::spsc_queue<uint64_t, 16>, num_queues>>();
+
+    uint64_t result;
+    size_t index;
+    EXPECT_FALSE(queues->pop(result, index));
+
+    queues->push(5, make_value(5, 0));
+    queues->push(5, make_value(5, 1));
+    queues->push(70, make_value(70, 0));
+
+    // Every ready queue yields one item per sweep, queue 5 is not visited twice before queue 70.
+    size_t indices[3];
+    for (auto& popped_index : indices)
+    {
+        ASSERT_TRUE(queues->pop(result, popped_index));
+        EXPECT_EQ(popped_index, result >> 32);
+    }
+    EXPECT_NE(indices[0], indices[1]);
+    EXPECT_EQ(5u, indices[2]);
+    EXPECT_EQ(make_value(5, 1), result);
+
+    EXPECT_FALSE(queues->pop(result, index));
+}
+
+TEST(test_fan_in, direct_push_with_ready_set)
+{
+    auto queues = std::make_unique<waitfree::fan_in<waitfree::mpsc_queue<uint64_t, 16>, 8>>();
+
+    queues->queue(2).push(make_value(2, 0));
+    uint64_t result;
+    EXPECT_FALSE(queues->pop(result));
+
+    queues->ready().set(2);
+    ASSERT_TRUE(queues->pop(result));
+    EXPECT_EQ(make_value(2, 0), result);
+}
+
+TEST(test_fan_in, multi_thread_push_pop_correctness)
+{
+    static constexpr size_t num_threads = 4;
+    auto queues = std::make_unique<waitfree::fan_in<waitfree::spsc_queue<uint64_t, 64>, num_queues>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queues, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                for (size_t queue_id = thread_id; queue_id < num_queues; queue_id += num_threads * 7)
+                {
+                    while (!queues->try_push(queue_id, make_value(queue_id, i)))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }));
+    }
+
+    size_t expected_total = 0;
+    std::vector<uint64_t> next_expected(num_queues, 0);
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        for (size_t queue_id = thread_id; queue_id < num_queues; queue_id += num_threads * 7)
+        {
+            expected_total += num_elements;
+        }
+    }
+
+    size_t pop_count = 0;
+    while (pop_count != expected_total)
+    {
+        uint64_t result;
+        size_t index;
+        if (!queues->pop(result, index))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_EQ(index, result >> 32);
+        EXPECT_EQ(make_value(index, next_expected[index]), result);
+        ++next_expected[index];
+        ++pop_count;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+
+    uint64_t result;
+    EXPECT_FALSE(queues->pop(result));
+}
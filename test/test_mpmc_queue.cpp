@@ -0,0 +1,235 @@
+#include "mpmc_queue.h"
+#include "test/test_helpers.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+constexpr size_t num_iterations = 4;
+
+constexpr uint64_t make_value(const uint64_t thread_id, const uint64_t iteration, const uint64_t element_id)
+{
+    return (thread_id << 32) | (iteration << 16) | element_id;
+}
+
+}// namespace
+
+TEST(test_mpmc_queue, is_empty)
+{
+    auto queue = std::make_unique<waitfree::mpmc_queue<uint64_t, 16>>();
+    EXPECT_TRUE(queue->empty());
+
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        queue->push(make_value(0, 0, i));
+    }
+    EXPECT_FALSE(queue->empty());
+
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        uint64_t result;
+        ASSERT_TRUE(queue->pop(result));
+        EXPECT_EQ(make_value(0, 0, i), result);
+    }
+    EXPECT_TRUE(queue->empty());
+
+    uint64_t result;
+    EXPECT_FALSE(queue->pop(result));
+}
+
+TEST(test_mpmc_queue, try_push_full)
+{
+    auto queue = std::make_unique<waitfree::mpmc_queue<uint64_t, 4>>();
+
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue->try_push(make_value(0, 0, i)));
+    }
+    EXPECT_FALSE(queue->try_push(make_value(0, 0, 4)));
+
+    uint64_t result;
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_EQ(make_value(0, 0, 0), result);
+    EXPECT_TRUE(queue->try_push(make_value(0, 0, 4)));
+    EXPECT_FALSE(queue->try_push(make_value(0, 0, 5)));
+
+    for (uint64_t i = 1; i < 5; ++i)
+    {
+        EXPECT_TRUE(queue->pop(result));
+        EXPECT_EQ(make_value(0, 0, i), result);
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_mpmc_queue, destructor_destroys_items)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        waitfree::mpmc_queue<std::shared_ptr<int>, 8> queue;
+        for (size_t i = 0; i < 5; ++i)
+        {
+            queue.push(value);
+        }
+
+        std::shared_ptr<int> result;
+        EXPECT_TRUE(queue.pop(result));
+        result.reset();
+        EXPECT_EQ(5, value.use_count());
+    }
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(test_mpmc_queue, multi_thread_push_pop_correctness)
+{
+    static constexpr size_t num_producers = 2;
+    static constexpr size_t num_consumers = 2;
+    auto queue = std::make_unique<waitfree::mpmc_queue<uint64_t, 1024>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_producers; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                if (!queue->try_push(make_value(thread_id, 0, i)))
+                {
+                    std::this_thread::yield();
+                    queue->push(make_value(thread_id, 0, i));
+                }
+            }
+        }));
+    }
+
+    std::atomic<size_t> pop_count{0};
+    std::vector<std::vector<uint64_t>> popped(num_consumers);
+    for (size_t consumer_id = 0; consumer_id < num_consumers; ++consumer_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, &pop_count, &popped, consumer_id]() {
+            uint64_t next_expected[num_producers] = {};
+            while (pop_count.load(std::memory_order_relaxed) != num_elements * num_producers)
+            {
+                uint64_t result;
+                if (!queue->pop(result))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // Each consumer sees the items of a producer in push order, with gaps taken by the other consumer.
+                const auto thread_id = result >> 32;
+                ASSERT_LT(thread_id, num_producers);
+                const auto element_id = result & 0xffff;
+                EXPECT_LE(next_expected[thread_id], element_id);
+                next_expected[thread_id] = element_id + 1;
+                popped[consumer_id].push_back(result);
+                pop_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }));
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+    EXPECT_TRUE(queue->empty());
+
+    std::vector<bool> seen(num_producers * num_elements, false);
+    for (const auto& values : popped)
+    {
+        for (const auto value : values)
+        {
+            const auto index = (value >> 32) * num_elements + (value & 0xffff);
+            EXPECT_FALSE(seen[index]);
+            seen[index] = true;
+        }
+    }
+}
+
+TEST(test_mpmc_queue, multi_thread_push_performance)
+{
+    auto queue = std::make_unique<waitfree::mpmc_queue<uint32_t, num_elements * num_iterations * 2>>();
+    sync_barrier<2> sync_point;
+
+    auto push_thread = [&queue, &sync_point](const size_t thread_id) {
+        sync_point.arrive(thread_id);
+        scoped_stats_average<num_iterations> stats("test_mpmc_queue::multiThreadPushPerformance " + std::to_string(thread_id));
+        for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+        {
+            scoped_timer timer;
+            for (uint32_t i = 0; i < num_elements; ++i)
+            {
+                queue->push(i);
+            }
+            stats.push(timer.get_ms());
+        }
+    };
+
+    auto push_thread_0 = std::make_unique<std::thread>(push_thread, 0);
+    auto push_thread_1 = std::make_unique<std::thread>(push_thread, 1);
+
+    sync_point.run();
+    push_thread_0->join();
+    push_thread_1->join();
+}
+
+TEST(test_mpmc_queue, multi_thread_push_pop_performance)
+{
+    auto queue = std::make_unique<waitfree::mpmc_queue<uint32_t, num_elements * num_iterations * 2>>();
+    sync_barrier<2> sync_point;
+
+    auto push_pop_thread = [&queue, &sync_point](const size_t thread_id) {
+        sync_point.arrive(thread_id);
+        scoped_stats_average<num_iterations> stats("test_mpmc_queue::multiThreadPushPopPerformance push pop " + std::to_string(thread_id));
+        for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+        {
+            scoped_timer timer;
+            for (uint32_t i = 0; i < num_elements; ++i)
+            {
+                queue->push(i);
+                uint32_t result;
+                queue->pop(result);
+            }
+            stats.push(timer.get_ms());
+        }
+    };
+
+    auto thread_0 = std::make_unique<std::thread>(push_pop_thread, 0);
+    auto thread_1 = std::make_unique<std::thread>(push_pop_thread, 1);
+
+    sync_point.run();
+    thread_0->join();
+    thread_1->join();
+}
+
+TEST(test_mpmc_queue, pop_performance)
+{
+    auto queue = std::make_unique<waitfree::mpmc_queue<uint32_t, num_elements>>();
+
+    scoped_stats_average<num_iterations> stats("test_mpmc_queue::popPerformance");
+    for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+    {
+        for (uint32_t i = 0; i < num_elements; ++i)
+        {
+            queue->push(i);
+        }
+
+        {
+            scoped_timer timer;
+            for (uint32_t i = 0; i < num_elements; ++i)
+            {
+                uint32_t result;
+                const auto pop_result = queue->pop(result);
+                EXPECT_TRUE(pop_result);
+            }
+            stats.push(timer.get_ms());
+        }
+    }
+}
@@ -1,11 +1,16 @@
 #include "mpsc_queue.h"
 #include "test/test_helpers.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
 namespace
 {
@@ -54,6 +59,418 @@ TEST(test_mpsc_queue, is_empty)
     EXPECT_TRUE(queue->empty());
 }
 
+TEST(test_mpsc_queue, front)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16>>();
+    EXPECT_EQ(nullptr, queue->front());
+
+    queue->push(make_value(0, 0, 1));
+    queue->push(make_value(0, 0, 2));
+
+    auto item = queue->front();
+    ASSERT_NE(nullptr, item);
+    EXPECT_EQ(make_value(0, 0, 1), *item);
+    EXPECT_EQ(item, queue->front());
+
+    uint64_t result;
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_EQ(make_value(0, 0, 1), result);
+
+    item = queue->front();
+    ASSERT_NE(nullptr, item);
+    EXPECT_EQ(make_value(0, 0, 2), *item);
+
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_EQ(nullptr, queue->front());
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_mpsc_queue, pop_bulk)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16>>();
+
+    std::vector<uint64_t> result;
+    EXPECT_EQ(0, queue->pop_bulk(std::back_inserter(result), 16));
+
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        queue->push(make_value(0, 0, i));
+    }
+
+    EXPECT_EQ(4, queue->pop_bulk(std::back_inserter(result), 4));
+    EXPECT_EQ(6, queue->pop_bulk(std::back_inserter(result), 16));
+    EXPECT_EQ(0, queue->pop_bulk(std::back_inserter(result), 16));
+    EXPECT_TRUE(queue->empty());
+
+    ASSERT_EQ(10, result.size());
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        EXPECT_EQ(make_value(0, 0, i), result[i]);
+    }
+}
+
+TEST(test_mpsc_queue, pop_bulk_wrap_around)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16>>();
+
+    uint64_t next_push = 0;
+    uint64_t next_pop = 0;
+    for (size_t iteration = 0; iteration < 8; ++iteration)
+    {
+        for (size_t i = 0; i < 11; ++i)
+        {
+            queue->push(next_push++);
+        }
+
+        uint64_t result[16];
+        EXPECT_EQ(11, queue->pop_bulk(result, 16));
+        for (size_t i = 0; i < 11; ++i)
+        {
+            EXPECT_EQ(next_pop++, result[i]);
+        }
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_mpsc_queue, prefetch_wrap_around)
+{
+    struct large_element
+    {
+        uint64_t values[32];
+    };
+    static_assert(sizeof(large_element) == 256);
+
+    auto queue = std::make_unique<waitfree::mpsc_queue<large_element, 16>>();
+    queue->set_prefetch_distance(4);
+
+    uint64_t next_push = 0;
+    uint64_t next_pop = 0;
+    for (size_t iteration = 0; iteration < 8; ++iteration)
+    {
+        for (size_t i = 0; i < 11; ++i)
+        {
+            large_element item;
+            std::fill(std::begin(item.values), std::end(item.values), next_push++);
+            queue->push(item);
+        }
+
+        large_element result[16];
+        EXPECT_TRUE(queue->pop(result[0]));
+        EXPECT_EQ(10, queue->pop_bulk(result + 1, 15));
+        for (size_t i = 0; i < 11; ++i)
+        {
+            EXPECT_EQ(next_pop, result[i].values[0]);
+            EXPECT_EQ(next_pop, result[i].values[31]);
+            ++next_pop;
+        }
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_mpsc_queue, try_push_full)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16>>();
+
+    for (size_t iteration = 0; iteration < 4; ++iteration)
+    {
+        for (uint64_t i = 0; i < 16; ++i)
+        {
+            EXPECT_TRUE(queue->try_push(make_value(0, iteration, i)));
+        }
+        EXPECT_FALSE(queue->try_push(make_value(0, iteration, 16)));
+
+        uint64_t result;
+        EXPECT_TRUE(queue->pop(result));
+        EXPECT_EQ(make_value(0, iteration, 0), result);
+        EXPECT_TRUE(queue->try_push(make_value(0, iteration, 16)));
+        EXPECT_FALSE(queue->try_push(make_value(0, iteration, 17)));
+
+        for (uint64_t i = 1; i < 17; ++i)
+        {
+            EXPECT_TRUE(queue->pop(result));
+            EXPECT_EQ(make_value(0, iteration, i), result);
+        }
+        EXPECT_TRUE(queue->empty());
+    }
+}
+
+TEST(test_mpsc_queue, multi_thread_try_push_correctness)
+{
+    constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 1024>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                while (!queue->try_push(make_value(thread_id, 0, i)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    uint64_t next_expected[num_threads] = {};
+    size_t pop_count = 0;
+    while (pop_count != num_elements * num_threads)
+    {
+        uint64_t result;
+        if (!queue->pop(result))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const auto thread_id = result >> 32;
+        ASSERT_LT(thread_id, num_threads);
+        EXPECT_EQ(make_value(thread_id, 0, next_expected[thread_id]), result);
+        ++next_expected[thread_id];
+        ++pop_count;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_mpsc_queue, packed_layout_push_pop)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint32_t, 16, waitfree::packed_layout>>();
+
+    for (size_t iteration = 0; iteration < 4; ++iteration)
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            EXPECT_TRUE(queue->try_push(i));
+        }
+        EXPECT_FALSE(queue->try_push(16u));
+
+        uint32_t result;
+        EXPECT_TRUE(queue->pop(result));
+        EXPECT_EQ(0, result);
+
+        uint32_t results[16];
+        EXPECT_EQ(15, queue->pop_bulk(results, 16));
+        for (uint32_t i = 0; i < 15; ++i)
+        {
+            EXPECT_EQ(i + 1, results[i]);
+        }
+        EXPECT_TRUE(queue->empty());
+    }
+}
+
+TEST(test_mpsc_queue, packed_layout_multi_thread_push_pop_correctness)
+{
+    constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, num_elements * 4, waitfree::packed_layout>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                queue->push(make_value(thread_id, 0, i));
+            }
+        }));
+    }
+
+    uint64_t next_expected[num_threads] = {};
+    size_t pop_count = 0;
+    while (pop_count != num_elements * num_threads)
+    {
+        uint64_t result;
+        if (!queue->pop(result))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const auto thread_id = result >> 32;
+        ASSERT_LT(thread_id, num_threads);
+        EXPECT_EQ(make_value(thread_id, 0, next_expected[thread_id]), result);
+        ++next_expected[thread_id];
+        ++pop_count;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_mpsc_queue, dynamic_capacity)
+{
+    EXPECT_THROW(waitfree::mpsc_queue_dyn<uint64_t>(0), std::invalid_argument);
+    EXPECT_THROW(waitfree::mpsc_queue_dyn<uint64_t>(1), std::invalid_argument);
+    EXPECT_THROW(waitfree::mpsc_queue_dyn<uint64_t>(24), std::invalid_argument);
+
+    auto queue = std::make_unique<waitfree::mpsc_queue_dyn<uint64_t>>(32);
+    EXPECT_EQ(32, queue->capacity());
+
+    for (size_t iteration = 0; iteration < 4; ++iteration)
+    {
+        for (uint64_t i = 0; i < 32; ++i)
+        {
+            EXPECT_TRUE(queue->try_push(make_value(0, iteration, i)));
+        }
+        EXPECT_FALSE(queue->try_push(make_value(0, iteration, 32)));
+
+        for (uint64_t i = 0; i < 32; ++i)
+        {
+            uint64_t result;
+            EXPECT_TRUE(queue->pop(result));
+            EXPECT_EQ(make_value(0, iteration, i), result);
+        }
+        EXPECT_TRUE(queue->empty());
+    }
+}
+
+TEST(test_mpsc_queue, claim_commit_front_release)
+{
+    struct packet
+    {
+        uint32_t length_;
+        uint8_t data_[60];
+    };
+    auto queue = std::make_unique<waitfree::mpsc_queue<packet, 16>>();
+
+    for (size_t iteration = 0; iteration < 8; ++iteration)
+    {
+        auto first = queue->claim();
+        auto second = queue->claim();
+        first->length_ = 1;
+        second->length_ = 2;
+
+        queue->commit(second);
+        EXPECT_EQ(nullptr, queue->front());
+        queue->commit(first);
+
+        auto item = queue->front();
+        ASSERT_NE(nullptr, item);
+        EXPECT_EQ(1, item->length_);
+        queue->release();
+
+        item = queue->front();
+        ASSERT_NE(nullptr, item);
+        EXPECT_EQ(2, item->length_);
+        queue->release();
+        EXPECT_EQ(nullptr, queue->front());
+    }
+}
+
+TEST(test_mpsc_queue, release_destroys_item)
+{
+    auto value = std::make_shared<int>(1);
+    auto queue = std::make_unique<waitfree::mpsc_queue<std::shared_ptr<int>, 16>>();
+
+    queue->commit(queue->claim(value));
+    EXPECT_EQ(2, value.use_count());
+    ASSERT_NE(nullptr, queue->front());
+    EXPECT_EQ(value, *queue->front());
+    queue->release();
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(test_mpsc_queue, claim_bulk)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16>>();
+
+    for (size_t iteration = 0; iteration < 8; ++iteration)
+    {
+        auto items = queue->claim_bulk(5);
+        ASSERT_EQ(5, items.size());
+        for (uint64_t i = 0; i < items.size(); ++i)
+        {
+            items[i] = make_value(0, iteration, i);
+        }
+
+        queue->commit(&items[1]);
+        EXPECT_EQ(nullptr, queue->front());
+        queue->commit(&items[0]);
+        for (uint64_t i = 2; i < items.size(); ++i)
+        {
+            queue->commit(&items[i]);
+        }
+
+        auto more = queue->claim_bulk(6);
+        for (uint64_t i = 0; i < more.size(); ++i)
+        {
+            more[i] = make_value(1, iteration, i);
+        }
+        queue->commit(more);
+
+        uint64_t results[16];
+        ASSERT_EQ(11, queue->pop_bulk(results, 16));
+        for (uint64_t i = 0; i < 5; ++i)
+        {
+            EXPECT_EQ(make_value(0, iteration, i), results[i]);
+        }
+        for (uint64_t i = 0; i < 6; ++i)
+        {
+            EXPECT_EQ(make_value(1, iteration, i), results[5 + i]);
+        }
+        EXPECT_TRUE(queue->empty());
+    }
+}
+
+TEST(test_mpsc_queue, multi_thread_push_bulk_correctness)
+{
+    constexpr size_t num_threads = 3;
+    constexpr size_t burst_size = 32;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, num_elements * 4>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, thread_id]() {
+            std::vector<uint64_t> burst(burst_size);
+            for (uint64_t i = 0; i < num_elements; i += burst_size)
+            {
+                for (uint64_t j = 0; j < burst_size; ++j)
+                {
+                    burst[j] = make_value(thread_id, 0, i + j);
+                }
+                queue->push_bulk(burst.begin(), burst.end());
+            }
+        }));
+    }
+
+    uint64_t next_expected[num_threads] = {};
+    size_t pop_count = 0;
+    std::vector<uint64_t> results;
+    while (pop_count != num_elements * num_threads)
+    {
+        results.clear();
+        if (queue->pop_bulk(std::back_inserter(results), 256) == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (const auto result : results)
+        {
+            const auto thread_id = result >> 32;
+            ASSERT_LT(thread_id, num_threads);
+            EXPECT_EQ(make_value(thread_id, 0, next_expected[thread_id]), result);
+            ++next_expected[thread_id];
+            ++pop_count;
+        }
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
 TEST(test_mpsc_queue, multi_thread_push_pop_correctness)
 {
     const size_t total_elements = num_elements * num_iterations * 4;
@@ -247,6 +664,39 @@ TEST(test_mpsc_queue, multi_thread_push_performance)
     pop_thread_1->join();
 }
 
+TEST(test_mpsc_queue, multi_thread_push_bulk_performance)
+{
+    constexpr size_t burst_size = 32;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint32_t, num_elements * num_iterations * 2>>();
+    sync_barrier<2> sync_point;
+
+    auto push_thread = [&queue, &sync_point](const size_t thread_id) {
+        sync_point.arrive(thread_id);
+        scoped_stats_average<num_iterations> stats("test_mpsc_queue::multiThreadPushBulkPerformance " + std::to_string(thread_id));
+        uint32_t burst[burst_size];
+        for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+        {
+            scoped_timer timer;
+            for (uint32_t i = 0; i < num_elements; i += burst_size)
+            {
+                for (uint32_t j = 0; j < burst_size; ++j)
+                {
+                    burst[j] = i + j;
+                }
+                queue->push_bulk(burst, burst + burst_size);
+            }
+            stats.push(timer.get_ms());
+        }
+    };
+
+    auto push_thread_0 = std::make_unique<std::thread>(push_thread, 0);
+    auto push_thread_1 = std::make_unique<std::thread>(push_thread, 1);
+
+    sync_point.run();
+    push_thread_0->join();
+    push_thread_1->join();
+}
+
 TEST(test_mpsc_queue, multi_thread_push_pop_performance)
 {
     auto queue = std::make_unique<waitfree::mpsc_queue<uint32_t, num_elements * num_iterations * 2>>();
@@ -312,6 +762,37 @@ TEST(test_mpsc_queue, pop_performance)
     }
 }
 
+TEST(test_mpsc_queue, pop_prefetch_performance)
+{
+    struct large_element
+    {
+        uint64_t values[32];
+    };
+
+    auto queue = std::make_unique<waitfree::mpsc_queue<large_element, num_elements>>();
+    queue->set_prefetch_distance(8);
+
+    scoped_stats_average<num_iterations> stats("test_mpsc_queue::popPrefetchPerformance");
+    for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+    {
+        for (uint64_t i = 0; i < num_elements; ++i)
+        {
+            queue->push(large_element{{i}});
+        }
+
+        {
+            scoped_timer timer;
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                large_element result;
+                const auto pop_result = queue->pop(result);
+                EXPECT_TRUE(pop_result);
+            }
+            stats.push(timer.get_ms());
+        }
+    }
+}
+
 TEST(test_mpsc_queue, pop_non_movable_with_non_trivial_destructor)
 {
     uint32_t count = 0;
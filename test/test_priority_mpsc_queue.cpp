@@ -0,0 +1,129 @@
+#include "priority_mpsc_queue.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+
+constexpr uint64_t make_value(const uint64_t thread_id, const uint64_t iteration, const uint64_t element_id)
+{
+    return (thread_id << 32) | (iteration << 16) | element_id;
+}
+
+}// namespace
+
+TEST(test_priority_mpsc_queue, pops_highest_priority_first)
+{
+    auto queue = std::make_unique<waitfree::priority_mpsc_queue<uint64_t, 16, 3>>();
+    EXPECT_TRUE(queue->empty());
+
+    queue->push(2, make_value(2, 0, 0));
+    queue->push(1, make_value(1, 0, 0));
+    queue->push(2, make_value(2, 0, 1));
+    queue->push(0, make_value(0, 0, 0));
+    EXPECT_FALSE(queue->empty());
+
+    const uint64_t expected[] = {make_value(0, 0, 0), make_value(1, 0, 0), make_value(2, 0, 0), make_value(2, 0, 1)};
+    for (const auto value : expected)
+    {
+        uint64_t result;
+        size_t lane;
+        ASSERT_TRUE(queue->pop(result, lane));
+        EXPECT_EQ(value, result);
+        EXPECT_EQ(value >> 32, lane);
+    }
+
+    uint64_t result;
+    EXPECT_FALSE(queue->pop(result));
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_priority_mpsc_queue, starvation_quantum)
+{
+    auto queue = std::make_unique<waitfree::priority_mpsc_queue<uint64_t, 64, 2>>(4);
+
+    for (uint64_t i = 0; i < 20; ++i)
+    {
+        queue->push(0, make_value(0, 0, i));
+    }
+    queue->push(1, make_value(1, 0, 0));
+    queue->push(1, make_value(1, 0, 1));
+
+    std::vector<size_t> lanes;
+    uint64_t result;
+    size_t lane;
+    while (queue->pop(result, lane))
+    {
+        lanes.push_back(lane);
+    }
+
+    const std::vector<size_t> expected = {0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    EXPECT_EQ(expected, lanes);
+}
+
+TEST(test_priority_mpsc_queue, try_push_full)
+{
+    auto queue = std::make_unique<waitfree::priority_mpsc_queue<uint64_t, 2, 2>>();
+
+    EXPECT_TRUE(queue->try_push(1, make_value(1, 0, 0)));
+    EXPECT_TRUE(queue->try_push(1, make_value(1, 0, 1)));
+    EXPECT_FALSE(queue->try_push(1, make_value(1, 0, 2)));
+    EXPECT_TRUE(queue->try_push(0, make_value(0, 0, 0)));
+
+    uint64_t result;
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_EQ(make_value(0, 0, 0), result);
+}
+
+TEST(test_priority_mpsc_queue, multi_thread_push_pop_correctness)
+{
+    static constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::priority_mpsc_queue<uint64_t, 1024, num_threads>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                while (!queue->try_push(thread_id, make_value(thread_id, 0, i)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    uint64_t next_expected[num_threads] = {};
+    size_t pop_count = 0;
+    while (pop_count != num_elements * num_threads)
+    {
+        uint64_t result;
+        size_t lane;
+        if (!queue->pop(result, lane))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_LT(lane, num_threads);
+        EXPECT_EQ(make_value(lane, 0, next_expected[lane]), result);
+        ++next_expected[lane];
+        ++pop_count;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+
+    uint64_t result;
+    EXPECT_FALSE(queue->pop(result));
+    EXPECT_TRUE(queue->empty());
+}
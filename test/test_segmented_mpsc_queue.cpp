@@ -0,0 +1,267 @@
+#include "segmented_mpsc_queue.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+
+constexpr uint64_t make_value(const uint64_t thread_id, const uint64_t iteration, const uint64_t element_id)
+{
+    return (thread_id << 32) | (iteration << 16) | element_id;
+}
+
+struct counting_allocator
+{
+    size_t* allocations_;
+    size_t* deallocations_ = nullptr;
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+        ++*allocations_;
+        return waitfree::default_allocator().allocate(size, alignment);
+    }
+
+    void deallocate(void* p, const size_t size, const size_t alignment) noexcept
+    {
+        if (deallocations_)
+        {
+            ++*deallocations_;
+        }
+        waitfree::default_allocator().deallocate(p, size, alignment);
+    }
+};
+
+/**
+ * Throws from the constructor when value is negative.
+ */
+struct throwing_item
+{
+    int value_ = 0;
+
+    throwing_item() = default;
+
+    explicit throwing_item(const int value)
+        : value_(value)
+    {
+        if (value < 0)
+        {
+            throw std::runtime_error("throwing_item");
+        }
+    }
+};
+
+}// namespace
+
+TEST(test_segmented_mpsc_queue, is_empty)
+{
+    auto queue = std::make_unique<waitfree::segmented_mpsc_queue<uint64_t, 16>>();
+    EXPECT_TRUE(queue->empty());
+
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        queue->push(make_value(0, 0, i));
+    }
+    EXPECT_FALSE(queue->empty());
+
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        uint64_t result;
+        EXPECT_TRUE(queue->pop(result));
+    }
+    EXPECT_TRUE(queue->empty());
+
+    queue->push(make_value(0, 0, 0));
+    EXPECT_FALSE(queue->empty());
+
+    uint64_t result;
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_TRUE(queue->empty());
+    EXPECT_FALSE(queue->pop(result));
+}
+
+TEST(test_segmented_mpsc_queue, push_pop_grows)
+{
+    auto queue = std::make_unique<waitfree::segmented_mpsc_queue<uint64_t, 16>>();
+
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        queue->push(make_value(0, 0, i));
+    }
+
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        uint64_t result;
+        ASSERT_TRUE(queue->pop(result));
+        EXPECT_EQ(make_value(0, 0, i), result);
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_segmented_mpsc_queue, steady_state_does_not_allocate)
+{
+    size_t allocations = 0;
+    auto queue = std::make_unique<waitfree::segmented_mpsc_queue<uint64_t, 16, waitfree::padded_layout, counting_allocator>>(counting_allocator{&allocations});
+
+    for (uint64_t i = 0; i < 64; ++i)
+    {
+        queue->push(make_value(0, 0, i));
+        uint64_t result;
+        ASSERT_TRUE(queue->pop(result));
+    }
+
+    const auto warm_allocations = allocations;
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        queue->push(make_value(0, 0, i));
+        uint64_t result;
+        ASSERT_TRUE(queue->pop(result));
+        EXPECT_EQ(make_value(0, 0, i), result);
+    }
+    EXPECT_EQ(warm_allocations, allocations);
+}
+
+TEST(test_segmented_mpsc_queue, segments_are_freed_by_destructor_only)
+{
+    // The segments of a drained backlog stay in the pool for the next one, they are only freed by the destructor.
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    {
+        waitfree::segmented_mpsc_queue<uint64_t, 16, waitfree::padded_layout, counting_allocator> queue(
+                counting_allocator{&allocations, &deallocations});
+        for (uint64_t round = 0; round < 2; ++round)
+        {
+            for (uint64_t i = 0; i < 16 * 32; ++i)
+            {
+                queue.push(make_value(0, round, i));
+            }
+
+            for (uint64_t i = 0; i < 16 * 32; ++i)
+            {
+                uint64_t result;
+                ASSERT_TRUE(queue.pop(result));
+                EXPECT_EQ(make_value(0, round, i), result);
+            }
+            EXPECT_EQ(0u, deallocations);
+        }
+        EXPECT_LE(allocations, 33u);
+    }
+    EXPECT_EQ(allocations, deallocations);
+}
+
+TEST(test_segmented_mpsc_queue, destructor_destroys_items)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        waitfree::segmented_mpsc_queue<std::shared_ptr<int>, 4> queue;
+        for (size_t i = 0; i < 10; ++i)
+        {
+            queue.push(value);
+        }
+
+        std::shared_ptr<int> result;
+        EXPECT_TRUE(queue.pop(result));
+        EXPECT_TRUE(queue.pop(result));
+        result.reset();
+        EXPECT_EQ(9, value.use_count());
+    }
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(test_segmented_mpsc_queue, push_copies_strings)
+{
+    waitfree::segmented_mpsc_queue<std::string, 4> queue;
+    for (size_t i = 0; i < 10; ++i)
+    {
+        const std::string item = "item " + std::to_string(i);
+        queue.push(item);
+    }
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        std::string result;
+        ASSERT_TRUE(queue.pop(result));
+        EXPECT_EQ("item " + std::to_string(i), result);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(test_segmented_mpsc_queue, throwing_constructor_skips_slot)
+{
+    waitfree::segmented_mpsc_queue<throwing_item, 4> queue;
+    queue.push(0);
+    // Leaves the rest of the first segment and the start of the second one to skip.
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_THROW(queue.push(-1), std::runtime_error);
+    }
+    queue.push(1);
+
+    throwing_item result;
+    ASSERT_TRUE(queue.pop(result));
+    EXPECT_EQ(0, result.value_);
+    ASSERT_TRUE(queue.pop(result));
+    EXPECT_EQ(1, result.value_);
+    EXPECT_FALSE(queue.pop(result));
+    EXPECT_TRUE(queue.empty());
+
+    EXPECT_THROW(queue.push(-1), std::runtime_error);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(result));
+    queue.push(2);
+    EXPECT_FALSE(queue.empty());
+    ASSERT_TRUE(queue.pop(result));
+    EXPECT_EQ(2, result.value_);
+}
+
+TEST(test_segmented_mpsc_queue, multi_thread_push_pop_correctness)
+{
+    constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::segmented_mpsc_queue<uint64_t, 64>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue, thread_id]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                queue->push(make_value(thread_id, 0, i));
+                if ((i & 255) == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+
+    uint64_t next_expected[num_threads] = {};
+    size_t pop_count = 0;
+    while (pop_count != num_elements * num_threads)
+    {
+        uint64_t result;
+        if (!queue->pop(result))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const auto thread_id = result >> 32;
+        ASSERT_LT(thread_id, num_threads);
+        EXPECT_EQ(make_value(thread_id, 0, next_expected[thread_id]), result);
+        ++next_expected[thread_id];
+        ++pop_count;
+    }
+
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+    EXPECT_TRUE(queue->empty());
+}
@@ -0,0 +1,125 @@
+#include "shm_queue.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+
+struct packet
+{
+    uint64_t sequence_;
+    uint32_t producer_;
+    uint8_t payload_[52];
+};
+
+std::string region_name(const char* test_name)
+{
+#ifdef _WIN32
+    return std::string("Local\\waitfree_") + test_name;
+#else
+    return std::string("/waitfree_") + test_name + "_" + std::to_string(getpid());
+#endif
+}
+
+}// namespace
+
+TEST(test_shm_queue, mpsc_separate_mappings)
+{
+    using queue_type = waitfree::shm_mpsc_queue<packet, 1024>;
+    const auto name = region_name("mpsc_separate_mappings");
+    auto creator_region = waitfree::shm_region::create(name, queue_type::required_size());
+    auto attach_region = waitfree::shm_region::open(name);
+    waitfree::shm_region::remove(name);
+    ASSERT_NE(creator_region.data(), attach_region.data());
+
+    queue_type consumer(creator_region.data(), creator_region.size(), waitfree::shm_mode::create);
+    queue_type producer(attach_region.data(), attach_region.size(), waitfree::shm_mode::attach);
+    EXPECT_TRUE(consumer.empty());
+
+    auto producer_thread = std::make_unique<std::thread>([&producer]() {
+        for (uint64_t i = 0; i < num_elements; ++i)
+        {
+            packet item{};
+            item.sequence_ = i;
+            item.payload_[i % sizeof(item.payload_)] = static_cast<uint8_t>(i);
+            while (!producer.try_push(item))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        packet item;
+        while (!consumer.pop(item))
+        {
+            std::this_thread::yield();
+        }
+        EXPECT_EQ(i, item.sequence_);
+        EXPECT_EQ(static_cast<uint8_t>(i), item.payload_[i % sizeof(item.payload_)]);
+    }
+
+    producer_thread->join();
+    EXPECT_TRUE(consumer.empty());
+}
+
+TEST(test_shm_queue, spsc_separate_mappings)
+{
+    using queue_type = waitfree::shm_spsc_queue<uint64_t, 1024>;
+    const auto name = region_name("spsc_separate_mappings");
+    auto creator_region = waitfree::shm_region::create(name, queue_type::required_size());
+    auto attach_region = waitfree::shm_region::open(name);
+    waitfree::shm_region::remove(name);
+
+    queue_type producer(creator_region.data(), creator_region.size(), waitfree::shm_mode::create);
+    queue_type consumer(attach_region.data(), attach_region.size(), waitfree::shm_mode::attach);
+
+    for (uint64_t i = 0; i < 1024; ++i)
+    {
+        EXPECT_TRUE(producer.try_push(i));
+    }
+    EXPECT_FALSE(producer.try_push(uint64_t(1024)));
+    EXPECT_EQ(1024, consumer.size());
+
+    for (uint64_t i = 0; i < 1024; ++i)
+    {
+        uint64_t result;
+        EXPECT_TRUE(consumer.pop(result));
+        EXPECT_EQ(i, result);
+    }
+    uint64_t result;
+    EXPECT_FALSE(consumer.pop(result));
+    EXPECT_TRUE(producer.try_push(uint64_t(1024)));
+    EXPECT_EQ(1, consumer.size());
+}
+
+TEST(test_shm_queue, attach_validates_layout)
+{
+    alignas(64) static uint8_t memory[waitfree::shm_mpsc_queue<uint64_t, 16>::required_size()];
+
+    EXPECT_THROW((waitfree::shm_mpsc_queue<uint64_t, 16>(memory, sizeof(memory), waitfree::shm_mode::attach)), std::runtime_error);
+    EXPECT_THROW((waitfree::shm_mpsc_queue<uint64_t, 16>(memory, sizeof(memory) - 1, waitfree::shm_mode::create)), std::invalid_argument);
+
+    waitfree::shm_mpsc_queue<uint64_t, 16> queue(memory, sizeof(memory), waitfree::shm_mode::create);
+    EXPECT_THROW((waitfree::shm_mpsc_queue<uint64_t, 8>(memory, sizeof(memory), waitfree::shm_mode::attach)), std::runtime_error);
+    EXPECT_THROW((waitfree::shm_mpsc_queue<uint32_t, 16>(memory, sizeof(memory), waitfree::shm_mode::attach)), std::runtime_error);
+    EXPECT_THROW((waitfree::shm_spsc_queue<uint64_t, 16>(memory, sizeof(memory), waitfree::shm_mode::attach)), std::runtime_error);
+
+    queue.push(uint64_t(42));
+    waitfree::shm_mpsc_queue<uint64_t, 16> attached(memory, sizeof(memory), waitfree::shm_mode::attach);
+    uint64_t result;
+    EXPECT_TRUE(attached.pop(result));
+    EXPECT_EQ(42, result);
+    EXPECT_TRUE(queue.empty());
+}
@@ -3,9 +3,13 @@
 #include "gtest/gtest.h"
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <unordered_set>
+#include <vector>
 
 namespace
 {
@@ -54,6 +58,256 @@ TEST(test_spsc_queue, size)
     EXPECT_EQ(0, queue->size());
 }
 
+TEST(test_spsc_queue, cache_line_padding)
+{
+    using queue_type = waitfree::spsc_queue<uint64_t, 1024>;
+    // size_, head_ and tail_ each start a cache line, after the line of the fields both threads only read.
+    EXPECT_EQ(waitfree::cache_line_size, alignof(queue_type));
+    EXPECT_GE(sizeof(queue_type), 4 * waitfree::cache_line_size);
+}
+
+TEST(test_spsc_queue, push_pop_bulk)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16>>();
+
+    std::vector<uint64_t> result;
+    EXPECT_EQ(0, queue->pop_bulk(std::back_inserter(result), 16));
+
+    std::vector<uint64_t> values;
+    for (uint64_t i = 0; i < 10; ++i)
+    {
+        values.push_back(make_value(0, 0, i));
+    }
+    EXPECT_EQ(10, queue->push_bulk(values.begin(), values.end()));
+    EXPECT_EQ(10, queue->size());
+
+    EXPECT_EQ(4, queue->pop_bulk(std::back_inserter(result), 4));
+    EXPECT_EQ(6, queue->size());
+    EXPECT_EQ(6, queue->pop_bulk(std::back_inserter(result), 16));
+    EXPECT_EQ(0, queue->size());
+    EXPECT_EQ(values, result);
+}
+
+TEST(test_spsc_queue, push_pop_bulk_wrap_around)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16>>();
+
+    uint64_t next_push = 0;
+    uint64_t next_pop = 0;
+    for (size_t iteration = 0; iteration < 8; ++iteration)
+    {
+        uint64_t values[11];
+        for (auto& value : values)
+        {
+            value = next_push++;
+        }
+        EXPECT_EQ(11, queue->push_bulk(std::begin(values), std::end(values)));
+
+        uint64_t result[16];
+        EXPECT_EQ(11, queue->pop_bulk(result, 16));
+        for (size_t i = 0; i < 11; ++i)
+        {
+            EXPECT_EQ(next_pop++, result[i]);
+        }
+    }
+    EXPECT_EQ(0, queue->size());
+}
+
+TEST(test_spsc_queue, push_pop_bulk_mixed_with_single)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 8>>();
+
+    // Single pushes move the ring position so the memcpy runs of the bulk calls split at the end of the buffer.
+    uint64_t result;
+    for (uint64_t i = 0; i < 5; ++i)
+    {
+        queue->push(i);
+        EXPECT_TRUE(queue->pop(result));
+    }
+
+    const uint64_t values[] = {10, 11, 12, 13, 14, 15};
+    EXPECT_EQ(6, queue->push_bulk(std::begin(values), std::end(values)));
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_EQ(10u, result);
+
+    uint64_t results[8];
+    EXPECT_EQ(5, queue->pop_bulk(results, 8));
+    for (size_t i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ(values[i + 1], results[i]);
+    }
+}
+
+TEST(test_spsc_queue, push_pop_bulk_non_trivial)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<std::string, 4>>();
+
+    const std::string values[] = {"first string that does not fit small buffers", "b", "c"};
+    for (size_t iteration = 0; iteration < 3; ++iteration)
+    {
+        EXPECT_EQ(3, queue->push_bulk(std::begin(values), std::end(values)));
+
+        std::string results[4];
+        EXPECT_EQ(3, queue->pop_bulk(results, 4));
+        for (size_t i = 0; i < 3; ++i)
+        {
+            EXPECT_EQ(values[i], results[i]);
+        }
+    }
+}
+
+TEST(test_spsc_queue, try_push_full)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16>>();
+
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        EXPECT_TRUE(queue->try_push(make_value(0, 0, i)));
+    }
+    EXPECT_FALSE(queue->try_push(make_value(0, 0, 16)));
+    EXPECT_EQ(16, queue->size());
+
+    uint64_t result;
+    EXPECT_TRUE(queue->pop(result));
+    EXPECT_EQ(make_value(0, 0, 0), result);
+    EXPECT_TRUE(queue->try_push(make_value(0, 0, 16)));
+    EXPECT_FALSE(queue->try_push(make_value(0, 0, 17)));
+
+    for (uint64_t i = 1; i < 17; ++i)
+    {
+        EXPECT_TRUE(queue->pop(result));
+        EXPECT_EQ(make_value(0, 0, i), result);
+    }
+    EXPECT_EQ(0, queue->size());
+}
+
+TEST(test_spsc_queue, dynamic_capacity)
+{
+    EXPECT_THROW(waitfree::spsc_queue_dyn<uint64_t>(0), std::invalid_argument);
+    EXPECT_THROW(waitfree::spsc_queue_dyn<uint64_t>(24), std::invalid_argument);
+
+    auto queue = std::make_unique<waitfree::spsc_queue_dyn<uint64_t>>(32);
+    EXPECT_EQ(32, queue->capacity());
+
+    for (size_t iteration = 0; iteration < 4; ++iteration)
+    {
+        for (uint64_t i = 0; i < 32; ++i)
+        {
+            EXPECT_TRUE(queue->try_push(make_value(0, iteration, i)));
+        }
+        EXPECT_FALSE(queue->try_push(make_value(0, iteration, 32)));
+        EXPECT_EQ(32, queue->size());
+
+        for (uint64_t i = 0; i < 32; ++i)
+        {
+            uint64_t result;
+            EXPECT_TRUE(queue->pop(result));
+            EXPECT_EQ(make_value(0, iteration, i), result);
+        }
+        EXPECT_EQ(0, queue->size());
+    }
+}
+
+TEST(test_spsc_queue, claim_commit_front_release)
+{
+    struct packet
+    {
+        uint32_t length_;
+        uint8_t data_[60];
+    };
+    auto queue = std::make_unique<waitfree::spsc_queue<packet, 16>>();
+
+    for (uint32_t i = 0; i < 40; ++i)
+    {
+        EXPECT_EQ(nullptr, queue->front());
+        auto item = queue->claim();
+        item->length_ = i;
+        EXPECT_EQ(nullptr, queue->front());
+        queue->commit();
+        EXPECT_EQ(1, queue->size());
+
+        auto front = queue->front();
+        ASSERT_NE(nullptr, front);
+        EXPECT_EQ(i, front->length_);
+        queue->release();
+        EXPECT_EQ(0, queue->size());
+    }
+}
+
+TEST(test_spsc_queue, release_destroys_item)
+{
+    auto value = std::make_shared<int>(1);
+    auto queue = std::make_unique<waitfree::spsc_queue<std::shared_ptr<int>, 16>>();
+
+    *queue->claim() = value;
+    queue->commit();
+    EXPECT_EQ(2, value.use_count());
+    ASSERT_NE(nullptr, queue->front());
+    EXPECT_EQ(value, *queue->front());
+    queue->release();
+    EXPECT_EQ(1, value.use_count());
+}
+
+TEST(test_spsc_queue, publish_batch)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 8>>();
+    queue->set_publish_batch(4);
+
+    uint64_t result;
+    for (uint64_t i = 0; i < 3; ++i)
+    {
+        queue->push(i);
+    }
+    EXPECT_EQ(0, queue->size());
+    EXPECT_FALSE(queue->pop(result));
+
+    queue->push(uint64_t(3));
+    EXPECT_EQ(4, queue->size());
+
+    const uint64_t values[] = {4, 5};
+    EXPECT_EQ(2, queue->push_bulk(std::begin(values), std::end(values)));
+    EXPECT_EQ(4, queue->size());
+    queue->flush();
+    EXPECT_EQ(6, queue->size());
+    queue->flush();
+    EXPECT_EQ(6, queue->size());
+
+    // Unpublished items count towards the capacity.
+    EXPECT_TRUE(queue->try_push(uint64_t(6)));
+    EXPECT_TRUE(queue->try_push(uint64_t(7)));
+    EXPECT_FALSE(queue->try_push(uint64_t(8)));
+    EXPECT_EQ(6, queue->size());
+    queue->flush();
+    EXPECT_EQ(8, queue->size());
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        EXPECT_TRUE(queue->pop(result));
+        EXPECT_EQ(i, result);
+    }
+
+    // Lowering the batch publishes what is pending.
+    queue->push(uint64_t(8));
+    EXPECT_EQ(0, queue->size());
+    queue->set_publish_batch(1);
+    EXPECT_EQ(1, queue->size());
+    queue->push(uint64_t(9));
+    EXPECT_EQ(2, queue->size());
+}
+
+TEST(test_spsc_queue, publish_batch_destroys_unpublished)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        auto queue = std::make_unique<waitfree::spsc_queue<std::shared_ptr<int>, 16>>();
+        queue->set_publish_batch(8);
+        queue->push(value);
+        queue->push(value);
+        EXPECT_EQ(3, value.use_count());
+    }
+    EXPECT_EQ(1, value.use_count());
+}
+
 TEST(test_spsc_queue, multi_thread_push_pop_correctness)
 {
     const size_t total_elements = num_elements * num_iterations * 2;
@@ -241,6 +495,87 @@ TEST(test_spsc_queue, multi_thread_push_pop_performance)
     thread_1->join();
 }
 
+TEST(test_spsc_queue, multi_thread_push_pop_publish_batch_correctness)
+{
+    static constexpr uint64_t num_items = num_elements * num_iterations;
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 1024>>();
+    queue->set_publish_batch(8);
+
+    std::thread producer([&queue]() {
+        for (uint64_t i = 0; i < num_items; ++i)
+        {
+            while (!queue->try_push(i))
+            {
+                std::this_thread::yield();
+            }
+            if ((i & 4095) == 4095)
+            {
+                queue->flush();
+            }
+        }
+        queue->flush();
+    });
+
+    uint64_t expected = 0;
+    uint64_t results[64];
+    while (expected < num_items)
+    {
+        const auto count = queue->pop_bulk(results, 64);
+        if (count == 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            ASSERT_EQ(expected++, results[i]);
+        }
+    }
+    producer.join();
+    EXPECT_EQ(0, queue->size());
+}
+
+TEST(test_spsc_queue, multi_thread_push_pop_publish_batch_performance)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, num_elements * num_iterations>>();
+    queue->set_publish_batch(waitfree::cache_line_size / sizeof(uint64_t));
+    sync_barrier<2> sync_point;
+
+    auto thread_0 = std::make_unique<std::thread>([&]() {
+        sync_point.arrive(0);
+        scoped_stats_average<num_iterations> stats("test_spsc_queue::multiThreadPushPopPublishBatchPerformance pop");
+        for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+        {
+            scoped_timer timer;
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                uint64_t result;
+                queue->pop(result);
+            }
+            stats.push(timer.get_ms());
+        }
+    });
+
+    auto thread_1 = std::make_unique<std::thread>([&]() {
+        sync_point.arrive(1);
+        scoped_stats_average<num_iterations> stats("test_spsc_queue::multiThreadPushPopPublishBatchPerformance push");
+        for (size_t iteration = 0; iteration < num_iterations; ++iteration)
+        {
+            scoped_timer timer;
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                queue->push(i);
+            }
+            stats.push(timer.get_ms());
+        }
+        queue->flush();
+    });
+
+    sync_point.run();
+    thread_0->join();
+    thread_1->join();
+}
+
 TEST(test_spsc_queue, pop_performance)
 {
     auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, num_elements * num_iterations>>();
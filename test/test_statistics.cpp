@@ -0,0 +1,105 @@
+#include "mpsc_queue.h"
+#include "spsc_queue.h"
+#include "spsc_queue_fast.h"
+#include "statistics.h"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+
+template<typename Q>
+void check_counters(Q& queue)
+{
+    uint64_t result;
+    EXPECT_FALSE(queue.pop(result));
+
+    for (uint64_t i = 0; i < 14; ++i)
+    {
+        EXPECT_TRUE(queue.try_push(i));
+    }
+    const uint64_t values[] = {14, 15};
+    EXPECT_EQ(2, queue.push_bulk(std::begin(values), std::end(values)));
+    EXPECT_FALSE(queue.try_push(uint64_t(16)));
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        EXPECT_TRUE(queue.pop(result));
+    }
+    uint64_t results[16];
+    EXPECT_EQ(8, queue.pop_bulk(results, 16));
+    EXPECT_EQ(0, queue.pop_bulk(results, 16));
+
+    const auto statistics = queue.statistics();
+    EXPECT_EQ(16u, statistics.pushed);
+    EXPECT_EQ(16u, statistics.popped);
+    EXPECT_EQ(2u, statistics.empty_pops);
+    EXPECT_EQ(1u, statistics.full);
+    // The single push reaching 14 of 16 slots and the bulk push reaching 16.
+    EXPECT_EQ(2u, statistics.near_full);
+    EXPECT_EQ(16u, statistics.high_water);
+}
+
+}// namespace
+
+TEST(test_statistics, no_statistics_is_zero)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16>>();
+    queue->push(uint64_t(1));
+    const auto statistics = queue->statistics();
+    EXPECT_EQ(0u, statistics.pushed);
+    EXPECT_EQ(0u, statistics.high_water);
+}
+
+TEST(test_statistics, mpsc_queue_counters)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16, waitfree::padded_layout, waitfree::default_allocator, waitfree::spin_wait,
+                                                       waitfree::queue_statistics<>>>();
+    check_counters(*queue);
+}
+
+TEST(test_statistics, spsc_queue_counters)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue<uint64_t, 16, waitfree::default_allocator, waitfree::spin_wait, waitfree::queue_statistics<>>>();
+    check_counters(*queue);
+}
+
+TEST(test_statistics, spsc_queue_fast_counters)
+{
+    auto queue = std::make_unique<waitfree::spsc_queue_fast<uint64_t, 16, waitfree::default_allocator, waitfree::spin_wait, waitfree::queue_statistics<>>>();
+    check_counters(*queue);
+}
+
+TEST(test_statistics, multi_thread_push_counters)
+{
+    static constexpr size_t num_threads = 3;
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, num_elements * 4, waitfree::packed_layout, waitfree::default_allocator,
+                                                       waitfree::spin_wait, waitfree::queue_statistics<2>>>();
+
+    std::vector<std::unique_ptr<std::thread>> threads;
+    for (size_t thread_id = 0; thread_id < num_threads; ++thread_id)
+    {
+        threads.emplace_back(std::make_unique<std::thread>([&queue]() {
+            for (uint64_t i = 0; i < num_elements; ++i)
+            {
+                queue->push(i);
+            }
+        }));
+    }
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+
+    const auto statistics = queue->statistics();
+    EXPECT_EQ(num_elements * num_threads, statistics.pushed);
+    EXPECT_EQ(num_elements * num_threads, statistics.high_water);
+    EXPECT_EQ(0u, statistics.near_full);
+}
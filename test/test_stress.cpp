@@ -0,0 +1,1441 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Every queue protocol window marked with WAITFREE_STRESS_POINT() calls into this file, so the macro has to be defined
+// before the queues are included.
+namespace stress
+{
+void point() noexcept;
+}// namespace stress
+
+#define WAITFREE_STRESS_POINT() stress::point()
+
+#include "byte_ring.h"
+#include "gtest/gtest.h"
+#include "mpmc_queue.h"
+#include "mpsc_queue.h"
+#include "segmented_mpsc_queue.h"
+#include "spsc_queue.h"
+#include "spsc_queue_fast.h"
+#include "statistics.h"
+#include "wait_strategy.h"
+
+namespace
+{
+
+// Scales the number of items of the randomized tests, set WAITFREE_STRESS_SCALE to run them for longer.
+uint64_t scale()
+{
+    static const uint64_t value = []() {
+        const auto* environment = std::getenv("WAITFREE_STRESS_SCALE");
+        return environment != nullptr ? std::max<uint64_t>(1, std::strtoull(environment, nullptr, 10)) : 1;
+    }();
+    return value;
+}
+
+// Seeds the delays and the operation mix of every thread. Printed so that a failing run can be repeated by setting
+// WAITFREE_STRESS_SEED, as far as the scheduling of the threads allows.
+uint64_t seed()
+{
+    static const uint64_t value = []() {
+        const auto* environment = std::getenv("WAITFREE_STRESS_SEED");
+        const uint64_t result = environment != nullptr ? std::strtoull(environment, nullptr, 10) : std::random_device()();
+        printf("WAITFREE_STRESS_SEED=%llu\n", static_cast<unsigned long long>(result));
+        return result;
+    }();
+    return value;
+}
+
+class xorshift
+{
+public:
+    explicit xorshift(const uint64_t stream)
+        : state_((seed() + stream) * 0x9e3779b97f4a7c15ull | 1)
+    {
+    }
+
+    uint64_t operator()() noexcept
+    {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+
+private:
+    uint64_t state_;
+};
+
+std::atomic<uint64_t> delay_streams{0};
+
+// Mostly returns right away, otherwise spins, yields or, rarely, sleeps so that the other threads run inside the window.
+void random_delay() noexcept
+{
+    thread_local xorshift random(delay_streams.fetch_add(1, std::memory_order_relaxed) + 0x5eed);
+    const auto value = random();
+    switch (value % 64)
+    {
+        case 0:
+            std::this_thread::yield();
+            break;
+        case 1:
+        case 2:
+            for (auto spins = (value >> 8) % 256; spins != 0; --spins)
+            {
+                waitfree::detail::cpu_relax();
+            }
+            break;
+        case 3:
+            if ((value >> 8) % 64 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Runs a set of threads one at a time, switching between them only at stress points, and tries every order of the
+ * switches depth first, replaying the choices of the previous run up to its last decision with an untried alternative.
+ * As in CHESS, the number of switches away from a thread that could have continued is bounded, which keeps the number
+ * of orders small while still covering the bugs that need a couple of preemptions. The runs are sequentially
+ * consistent, the randomized tests below run under ThreadSanitizer for the memory orders.
+ *
+ * The thread bodies must be deterministic for a given order, and must call wait() instead of spinning when they can
+ * not progress until another thread runs. A waiting thread is only run again after another thread passed a stress
+ * point or finished, or when every thread waits.
+ */
+class interleaving_explorer
+{
+public:
+    using bodies = std::vector<std::function<void()>>;
+
+    explicit interleaving_explorer(const size_t preemption_bound)
+        : preemption_bound_(preemption_bound)
+    {
+    }
+
+    /**
+     * Calls setup for a fresh set of bodies, one per thread, and runs them until every order within the preemption
+     * bound has been tried. Returns the number of runs.
+     */
+    size_t explore(const std::function<bodies()>& setup)
+    {
+        size_t runs = 0;
+        do
+        {
+            auto threads_bodies = setup();
+            step_ = 0;
+            schedules_ = 0;
+            preemptions_ = 0;
+            running_ = 0;
+            finished_.assign(threads_bodies.size(), false);
+            waiting_.assign(threads_bodies.size(), false);
+
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < threads_bodies.size(); ++i)
+            {
+                threads.emplace_back([this, i, &threads_bodies]() {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        changed_.wait(lock, [this, i]() { return running_ == i; });
+                    }
+                    current_ = this;
+                    index_ = i;
+                    threads_bodies[i]();
+                    current_ = nullptr;
+                    finish(i);
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+            ++runs;
+        } while (advance());
+        return runs;
+    }
+
+    /**
+     * Lets another thread run if the order being tried says so. Called from the stress points of the queues.
+     */
+    static bool point() noexcept
+    {
+        if (current_ == nullptr)
+        {
+            return false;
+        }
+        current_->schedule(false);
+        return true;
+    }
+
+    /**
+     * Switches to another thread, the calling thread can not progress until one of them has run.
+     */
+    static void wait() noexcept
+    {
+        current_->schedule(true);
+    }
+
+private:
+    struct decision
+    {
+        size_t choice;
+        size_t alternatives;
+    };
+
+    void schedule(const bool blocked)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (++schedules_ > max_schedules)
+        {
+            fprintf(stderr, "interleaving_explorer: no progress after %zu switches, the threads livelock\n", max_schedules);
+            std::abort();
+        }
+
+        const auto self = index_;
+        std::vector<size_t> candidates;
+        if (blocked)
+        {
+            waiting_[self] = true;
+            candidates = runnable(self, false);
+            if (candidates.empty())
+            {
+                // Every thread waits, let them all check their condition again.
+                candidates = runnable(self, true);
+            }
+            if (candidates.empty())
+            {
+                // Every other thread has finished, the caller has to find out on its own that it will never progress.
+                waiting_[self] = false;
+                return;
+            }
+        }
+        else
+        {
+            waiting_.assign(waiting_.size(), false);
+            candidates.push_back(self);
+            if (preemptions_ < preemption_bound_)
+            {
+                const auto others = runnable(self, false);
+                candidates.insert(candidates.end(), others.begin(), others.end());
+            }
+        }
+
+        const auto next = candidates[choose(candidates.size())];
+        if (!blocked && next != self)
+        {
+            ++preemptions_;
+        }
+        switch_to(next, self, lock);
+        waiting_[self] = false;
+    }
+
+    std::vector<size_t> runnable(const size_t self, const bool include_waiting) const
+    {
+        std::vector<size_t> threads;
+        for (size_t i = 0; i < finished_.size(); ++i)
+        {
+            if (i != self && !finished_[i] && (include_waiting || !waiting_[i]))
+            {
+                threads.push_back(i);
+            }
+        }
+        return threads;
+    }
+
+    void finish(const size_t self)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_[self] = true;
+        waiting_.assign(waiting_.size(), false);
+        const auto candidates = runnable(self, true);
+        if (!candidates.empty())
+        {
+            running_ = candidates[choose(candidates.size())];
+            changed_.notify_all();
+        }
+    }
+
+    size_t choose(const size_t alternatives)
+    {
+        if (alternatives == 1)
+        {
+            return 0;
+        }
+        if (step_ == path_.size())
+        {
+            path_.push_back({0, alternatives});
+        }
+        EXPECT_EQ(alternatives, path_[step_].alternatives) << "the thread bodies are not deterministic";
+        return std::min(path_[step_++].choice, alternatives - 1);
+    }
+
+    void switch_to(const size_t next, const size_t self, std::unique_lock<std::mutex>& lock)
+    {
+        if (next == self)
+        {
+            return;
+        }
+        running_ = next;
+        changed_.notify_all();
+        changed_.wait(lock, [this, self]() { return running_ == self; });
+    }
+
+    // Moves to the next order, the deepest decision with an untried alternative takes it and everything after it is
+    // chosen afresh.
+    bool advance()
+    {
+        while (!path_.empty() && path_.back().choice + 1 == path_.back().alternatives)
+        {
+            path_.pop_back();
+        }
+        if (path_.empty())
+        {
+            return false;
+        }
+        ++path_.back().choice;
+        return true;
+    }
+
+    static constexpr size_t max_schedules = 100000;
+
+    static thread_local interleaving_explorer* current_;
+    static thread_local size_t index_;
+
+    const size_t preemption_bound_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    size_t running_ = 0;
+    std::vector<bool> finished_;
+    std::vector<bool> waiting_;
+    std::vector<decision> path_;
+    size_t step_ = 0;
+    size_t schedules_ = 0;
+    size_t preemptions_ = 0;
+};
+
+thread_local interleaving_explorer* interleaving_explorer::current_ = nullptr;
+thread_local size_t interleaving_explorer::index_ = 0;
+
+constexpr size_t preemption_bound = 2;
+
+uint64_t encode(const uint64_t producer, const uint64_t sequence)
+{
+    return producer << 32 | sequence;
+}
+
+/**
+ * Checks on the consumer side that no item is lost, duplicated or reordered with regards to its producer.
+ */
+class order_checker
+{
+public:
+    explicit order_checker(const size_t producers)
+        : next_(producers, 0)
+    {
+    }
+
+    void check(const uint64_t item)
+    {
+        const auto producer = item >> 32;
+        ASSERT_LT(producer, next_.size());
+        ASSERT_EQ(next_[producer], item & 0xffffffff) << "producer " << producer;
+        ++next_[producer];
+        ++received_;
+    }
+
+    [[nodiscard]] uint64_t received() const noexcept
+    {
+        return received_;
+    }
+
+private:
+    std::vector<uint64_t> next_;
+    uint64_t received_ = 0;
+};
+
+/**
+ * Bounds the items in flight, so that producers can use the operations that assert on a full queue.
+ */
+class credits
+{
+public:
+    explicit credits(const int64_t count)
+        : available_(count)
+    {
+    }
+
+    void acquire(const int64_t count) noexcept
+    {
+        for (;;)
+        {
+            auto available = available_.load(std::memory_order_relaxed);
+            while (available >= count)
+            {
+                if (available_.compare_exchange_weak(available, available - count, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    return;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void release(const int64_t count) noexcept
+    {
+        available_.fetch_add(count, std::memory_order_release);
+    }
+
+private:
+    std::atomic<int64_t> available_;
+};
+
+/**
+ * Producers mix every push operation of mpsc_queue, the consumer every pop operation.
+ */
+template<typename Queue>
+void stress_mpsc(Queue& queue, const size_t producers, const uint64_t items_per_producer)
+{
+    credits credit(static_cast<int64_t>(queue.capacity()));
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, &credit, p, items_per_producer]() {
+            xorshift random(p);
+            uint64_t next = 0;
+            while (next < items_per_producer)
+            {
+                const auto value = random();
+                const auto count = std::min<uint64_t>(1 + (value >> 8) % 4, items_per_producer - next);
+                switch (value % 6)
+                {
+                    case 0:
+                        credit.acquire(1);
+                        queue.push(encode(p, next++));
+                        break;
+                    case 1:
+                        credit.acquire(1);
+                        EXPECT_TRUE(queue.try_push(encode(p, next++)));
+                        break;
+                    case 2:
+                    {
+                        credit.acquire(1);
+                        auto* item = queue.claim(encode(p, next++));
+                        random_delay();
+                        queue.commit(item);
+                        break;
+                    }
+                    case 3:
+                    {
+                        credit.acquire(static_cast<int64_t>(count));
+                        auto reservation = queue.claim_bulk(count);
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            reservation[i] = encode(p, next++);
+                        }
+                        queue.commit(reservation);
+                        break;
+                    }
+                    case 4:
+                    {
+                        credit.acquire(static_cast<int64_t>(count));
+                        uint64_t items[4];
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            items[i] = encode(p, next++);
+                        }
+                        EXPECT_EQ(count, queue.push_bulk(items, items + count));
+                        break;
+                    }
+                    default:
+                    {
+                        credit.acquire(static_cast<int64_t>(count));
+                        auto reservation = queue.claim_bulk(count);
+                        // Committed one by one, in reverse, the consumer must still wait for the first one.
+                        for (size_t i = count; i-- != 0;)
+                        {
+                            reservation[i] = encode(p, next + i);
+                            queue.commit(&reservation[i]);
+                        }
+                        next += count;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+
+    order_checker checker(producers);
+    xorshift random(producers);
+    const auto total = producers * items_per_producer;
+    while (checker.received() < total && !::testing::Test::HasFatalFailure())
+    {
+        uint64_t items[8];
+        size_t count = 0;
+        switch (random() % 3)
+        {
+            case 0:
+                count = queue.pop(items[0]) ? 1 : 0;
+                break;
+            case 1:
+                count = queue.pop_bulk(items, 8);
+                break;
+            default:
+                if (const auto* item = queue.front())
+                {
+                    items[0] = *item;
+                    queue.release();
+                    count = 1;
+                }
+                break;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            checker.check(items[i]);
+        }
+        if (count == 0)
+        {
+            std::this_thread::yield();
+        }
+        credit.release(static_cast<int64_t>(count));
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(total, checker.received());
+    EXPECT_TRUE(queue.empty());
+}
+
+/**
+ * Producers mix every push operation of a single producer queue, the consumer every pop operation. With Batched the
+ * producer changes the publish batch of spsc_queue as it goes.
+ */
+template<bool Batched, typename Queue>
+void stress_spsc(Queue& queue, const uint64_t items)
+{
+    credits credit(static_cast<int64_t>(queue.capacity()));
+    std::thread producer([&queue, &credit, items]() {
+        xorshift random(0);
+        uint64_t next = 0;
+        while (next < items)
+        {
+            const auto value = random();
+            const auto count = std::min<uint64_t>(1 + (value >> 8) % 4, items - next);
+            switch (value % 5)
+            {
+                case 0:
+                    credit.acquire(1);
+                    queue.push(encode(0, next++));
+                    break;
+                case 1:
+                    credit.acquire(1);
+                    EXPECT_TRUE(queue.try_push(encode(0, next++)));
+                    break;
+                case 2:
+                {
+                    credit.acquire(1);
+                    *queue.claim() = encode(0, next++);
+                    random_delay();
+                    queue.commit();
+                    break;
+                }
+                case 3:
+                {
+                    credit.acquire(static_cast<int64_t>(count));
+                    uint64_t bulk[4];
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        bulk[i] = encode(0, next++);
+                    }
+                    EXPECT_EQ(count, queue.push_bulk(bulk, bulk + count));
+                    break;
+                }
+                default:
+                    if constexpr (Batched)
+                    {
+                        if ((value >> 16) % 8 == 0)
+                        {
+                            queue.set_publish_batch(1 + (value >> 24) % 8);
+                        }
+                        else
+                        {
+                            queue.flush();
+                        }
+                    }
+                    break;
+            }
+        }
+        if constexpr (Batched)
+        {
+            queue.flush();
+        }
+    });
+
+    order_checker checker(1);
+    xorshift random(1);
+    while (checker.received() < items && !::testing::Test::HasFatalFailure())
+    {
+        uint64_t bulk[8];
+        size_t count = 0;
+        switch (random() % 3)
+        {
+            case 0:
+                count = queue.pop(bulk[0]) ? 1 : 0;
+                break;
+            case 1:
+                count = queue.pop_bulk(bulk, 8);
+                break;
+            default:
+                if (const auto* item = queue.front())
+                {
+                    bulk[0] = *item;
+                    queue.release();
+                    count = 1;
+                }
+                break;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            checker.check(bulk[i]);
+        }
+        if (count == 0)
+        {
+            std::this_thread::yield();
+        }
+        credit.release(static_cast<int64_t>(count));
+    }
+
+    producer.join();
+    EXPECT_EQ(items, checker.received());
+    EXPECT_EQ(0u, queue.size());
+}
+
+// Byte ring message of producer p with sequence number s, the size and every byte after the header follow from both.
+size_t message_size(const uint64_t p, const uint64_t s, const size_t max)
+{
+    return sizeof(uint64_t) + static_cast<size_t>((p * 31 + s * 7) % (max - sizeof(uint64_t) + 1));
+}
+
+uint8_t message_byte(const uint64_t s, const size_t i)
+{
+    return static_cast<uint8_t>(s + i);
+}
+
+/**
+ * Fails the test when a queue frees memory before its destructor runs, a stalled producer can still hold a pointer
+ * into any segment of a segmented_mpsc_queue.
+ */
+struct destructor_only_allocator
+{
+    const std::atomic<bool>* destroying_;
+
+    void* allocate(const size_t size, const size_t alignment) noexcept
+    {
+        return waitfree::default_allocator().allocate(size, alignment);
+    }
+
+    void deallocate(void* pointer, const size_t size, const size_t alignment) noexcept
+    {
+        EXPECT_TRUE(destroying_->load(std::memory_order_relaxed)) << "memory freed while the queue is alive";
+        waitfree::default_allocator().deallocate(pointer, size, alignment);
+    }
+};
+
+template<size_t S>
+struct guarded_segmented_queue
+{
+    using queue_type = waitfree::segmented_mpsc_queue<uint64_t, S, waitfree::padded_layout, destructor_only_allocator>;
+
+    std::atomic<bool> destroying{false};
+    std::unique_ptr<queue_type> queue = std::make_unique<queue_type>(destructor_only_allocator{&destroying});
+
+    ~guarded_segmented_queue()
+    {
+        destroying.store(true, std::memory_order_relaxed);
+        queue.reset();
+    }
+};
+
+}// namespace
+
+namespace stress
+{
+
+void point() noexcept
+{
+    if (!interleaving_explorer::point())
+    {
+        random_delay();
+    }
+}
+
+}// namespace stress
+
+TEST(test_stress, mpsc_queue_push_modes)
+{
+    for (size_t producers = 1; producers <= 4; ++producers)
+    {
+        waitfree::mpsc_queue<uint64_t, 64> queue;
+        stress_mpsc(queue, producers, 20000 * scale());
+    }
+}
+
+TEST(test_stress, mpsc_queue_packed_dynamic)
+{
+    for (size_t producers = 1; producers <= 4; ++producers)
+    {
+        waitfree::mpsc_queue_dyn<uint64_t, waitfree::packed_layout> queue(16);
+        queue.set_prefetch_distance(4);
+        stress_mpsc(queue, producers, 20000 * scale());
+    }
+}
+
+TEST(test_stress, mpsc_queue_timestamped_statistics)
+{
+    waitfree::mpsc_queue<uint64_t, 32, waitfree::timestamped_layout, waitfree::default_allocator, waitfree::spin_wait,
+                         waitfree::queue_statistics<>>
+            queue;
+    stress_mpsc(queue, 3, 20000 * scale());
+    const auto statistics = queue.statistics();
+    EXPECT_EQ(3 * 20000 * scale(), statistics.pushed);
+    EXPECT_EQ(3 * 20000 * scale(), statistics.popped);
+}
+
+TEST(test_stress, mpsc_queue_try_push_full)
+{
+    static constexpr size_t producers = 4;
+    const uint64_t items_per_producer = 20000 * scale();
+    waitfree::mpsc_queue<uint64_t, 4> queue;
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, p, items_per_producer]() {
+            for (uint64_t i = 0; i < items_per_producer;)
+            {
+                if (queue.try_push(encode(p, i)))
+                {
+                    ++i;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    order_checker checker(producers);
+    uint64_t item;
+    while (checker.received() < producers * items_per_producer && !HasFatalFailure())
+    {
+        if (queue.pop(item))
+        {
+            checker.check(item);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(test_stress, mpsc_queue_destructor_after_concurrent_push)
+{
+    // The destructor reads the sequences relaxed, joining the producers is what orders their pushes before it.
+    static constexpr size_t producers = 3;
+    static constexpr size_t items_per_producer = 64;
+    auto sentinel = std::make_shared<uint64_t>(0);
+    for (uint64_t round = 0; round < 200 * scale(); ++round)
+    {
+        auto queue = std::make_unique<waitfree::mpsc_queue<std::shared_ptr<uint64_t>, 256>>();
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&queue, &sentinel]() {
+                for (size_t i = 0; i < items_per_producer; ++i)
+                {
+                    queue->push(sentinel);
+                }
+            });
+        }
+
+        std::shared_ptr<uint64_t> item;
+        for (uint64_t popped = 0; popped < round % (producers * items_per_producer);)
+        {
+            if (queue->pop(item))
+            {
+                ++popped;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        item.reset();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        queue.reset();
+        ASSERT_EQ(1, sentinel.use_count());
+    }
+}
+
+TEST(test_stress, segmented_mpsc_queue_reuses_segments)
+{
+    // Two slot segments, so producers keep crossing segments and stall with pointers to ones the consumer drains.
+    for (size_t producers = 1; producers <= 4; ++producers)
+    {
+        const uint64_t items_per_producer = 20000 * scale();
+        guarded_segmented_queue<2> guarded;
+        auto& queue = *guarded.queue;
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&queue, p, items_per_producer]() {
+                for (uint64_t i = 0; i < items_per_producer; ++i)
+                {
+                    queue.push(encode(p, i));
+                    random_delay();
+                }
+            });
+        }
+
+        order_checker checker(producers);
+        xorshift random(producers);
+        uint64_t item;
+        while (checker.received() < producers * items_per_producer && !HasFatalFailure())
+        {
+            if (queue.pop(item))
+            {
+                checker.check(item);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+            if (random() % 4096 == 0)
+            {
+                // Lets a backlog of segments build up, more than are reused right away.
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST(test_stress, spsc_queue_publish_batch)
+{
+    waitfree::spsc_queue<uint64_t, 64> queue;
+    stress_spsc<true>(queue, 100000 * scale());
+}
+
+TEST(test_stress, spsc_queue_dynamic)
+{
+    waitfree::spsc_queue_dyn<uint64_t> queue(8);
+    stress_spsc<false>(queue, 100000 * scale());
+}
+
+TEST(test_stress, spsc_queue_fast)
+{
+    waitfree::spsc_queue_fast<uint64_t, 16> queue;
+    stress_spsc<false>(queue, 100000 * scale());
+}
+
+TEST(test_stress, mpmc_queue_producers_consumers)
+{
+    static constexpr size_t producers = 3;
+    static constexpr size_t consumers = 3;
+    const uint64_t items_per_producer = 20000 * scale();
+    waitfree::mpmc_queue<uint64_t, 16> queue;
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&queue, p, items_per_producer]() {
+            xorshift random(p);
+            for (uint64_t i = 0; i < items_per_producer;)
+            {
+                if (random() % 2 == 0)
+                {
+                    queue.push(encode(p, i++));
+                }
+                else if (queue.try_push(encode(p, i)))
+                {
+                    ++i;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::atomic<uint64_t> received{0};
+    std::vector<std::vector<uint64_t>> popped(consumers);
+    for (size_t c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&queue, &received, &popped = popped[c], items_per_producer]() {
+            // Each consumer pops the items of a producer in the order they were pushed, with gaps.
+            std::vector<int64_t> last(producers, -1);
+            uint64_t item;
+            while (received.load(std::memory_order_relaxed) < producers * items_per_producer)
+            {
+                if (!queue.pop(item))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const auto producer = item >> 32;
+                const auto sequence = static_cast<int64_t>(item & 0xffffffff);
+                ASSERT_LT(producer, producers);
+                ASSERT_LT(last[producer], sequence);
+                last[producer] = sequence;
+                popped.push_back(item);
+                received.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<uint64_t> all;
+    for (const auto& items : popped)
+    {
+        all.insert(all.end(), items.begin(), items.end());
+    }
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(producers * items_per_producer, all.size());
+    for (size_t p = 0; p < producers; ++p)
+    {
+        for (uint64_t i = 0; i < items_per_producer; ++i)
+        {
+            ASSERT_EQ(encode(p, i), all[p * items_per_producer + i]);
+        }
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(test_stress, mpmc_queue_destructor_after_concurrent_push)
+{
+    static constexpr size_t producers = 3;
+    static constexpr size_t items_per_producer = 64;
+    auto sentinel = std::make_shared<uint64_t>(0);
+    for (uint64_t round = 0; round < 200 * scale(); ++round)
+    {
+        auto queue = std::make_unique<waitfree::mpmc_queue<std::shared_ptr<uint64_t>, 256>>();
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&queue, &sentinel]() {
+                for (size_t i = 0; i < items_per_producer; ++i)
+                {
+                    queue->push(sentinel);
+                }
+            });
+        }
+        std::shared_ptr<uint64_t> item;
+        for (uint64_t popped = 0; popped < round % (producers * items_per_producer);)
+        {
+            if (queue->pop(item))
+            {
+                ++popped;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        item.reset();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        queue.reset();
+        ASSERT_EQ(1, sentinel.use_count());
+    }
+}
+
+TEST(test_stress, mpsc_byte_ring_messages)
+{
+    using ring_type = waitfree::mpsc_byte_ring<1024>;
+    static constexpr size_t producers = 3;
+    static constexpr size_t max_size = 200;
+    const uint64_t messages_per_producer = 20000 * scale();
+    auto ring = std::make_unique<ring_type>();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&ring, p, messages_per_producer]() {
+            xorshift random(p);
+            for (uint64_t s = 0; s < messages_per_producer;)
+            {
+                const auto size = message_size(p, s, max_size);
+                uint8_t message[max_size];
+                const auto header = encode(p, s);
+                std::memcpy(message, &header, sizeof(header));
+                for (size_t i = sizeof(header); i < size; ++i)
+                {
+                    message[i] = message_byte(s, i);
+                }
+
+                bool pushed;
+                if (random() % 2 == 0)
+                {
+                    pushed = ring->push(message, size);
+                }
+                else
+                {
+                    // Reserves the largest message and commits the actual size, like a serializer would.
+                    auto reserved = ring->reserve(max_size);
+                    pushed = !reserved.empty();
+                    if (pushed)
+                    {
+                        std::memcpy(reserved.data(), message, size);
+                        random_delay();
+                        ring->commit(reserved, size);
+                    }
+                }
+
+                if (pushed)
+                {
+                    ++s;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    order_checker checker(producers);
+    while (checker.received() < producers * messages_per_producer && !HasFatalFailure())
+    {
+        const auto message = ring->read();
+        if (message.empty())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint64_t header;
+        ASSERT_GE(message.size(), sizeof(header));
+        std::memcpy(&header, message.data(), sizeof(header));
+        const auto p = header >> 32;
+        const auto s = header & 0xffffffff;
+        ASSERT_EQ(message_size(p, s, max_size), message.size());
+        for (size_t i = sizeof(header); i < message.size(); ++i)
+        {
+            ASSERT_EQ(message_byte(s, i), static_cast<uint8_t>(message.data()[i]));
+        }
+        checker.check(header);
+        ring->release();
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_TRUE(ring->empty());
+}
+
+TEST(test_stress, interleavings_mpsc_push_pop)
+{
+    static constexpr size_t producers = 2;
+    static constexpr size_t items_per_producer = 2;
+    using queue_type = waitfree::mpsc_queue<uint64_t, 4>;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        auto queue = std::make_shared<queue_type>();
+        auto done = std::make_shared<std::atomic<size_t>>(0);
+        interleaving_explorer::bodies bodies;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            bodies.emplace_back([queue, done, p]() {
+                for (uint64_t i = 0; i < items_per_producer; ++i)
+                {
+                    if (p == 0)
+                    {
+                        queue->push(encode(p, i));
+                    }
+                    else
+                    {
+                        EXPECT_TRUE(queue->try_push(encode(p, i)));
+                    }
+                }
+                done->fetch_add(1);
+            });
+        }
+        bodies.emplace_back([queue, done]() {
+            order_checker checker(producers);
+            uint64_t item;
+            while (checker.received() < producers * items_per_producer)
+            {
+                if (queue->pop(item))
+                {
+                    checker.check(item);
+                }
+                else if (done->load() == producers)
+                {
+                    break;
+                }
+                else
+                {
+                    interleaving_explorer::wait();
+                }
+            }
+            EXPECT_EQ(producers * items_per_producer, checker.received());
+        });
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
+
+TEST(test_stress, interleavings_mpsc_try_push_full)
+{
+    static constexpr size_t producers = 2;
+    static constexpr size_t items_per_producer = 3;
+    using queue_type = waitfree::mpsc_queue<uint64_t, 2>;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        auto queue = std::make_shared<queue_type>();
+        auto done = std::make_shared<std::atomic<size_t>>(0);
+        interleaving_explorer::bodies bodies;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            bodies.emplace_back([queue, done, p]() {
+                for (uint64_t i = 0; i < items_per_producer;)
+                {
+                    if (queue->try_push(encode(p, i)))
+                    {
+                        ++i;
+                    }
+                    else
+                    {
+                        interleaving_explorer::wait();
+                    }
+                }
+                done->fetch_add(1);
+            });
+        }
+        bodies.emplace_back([queue, done]() {
+            order_checker checker(producers);
+            uint64_t item;
+            while (checker.received() < producers * items_per_producer)
+            {
+                if (queue->pop(item))
+                {
+                    checker.check(item);
+                }
+                else if (done->load() == producers)
+                {
+                    break;
+                }
+                else
+                {
+                    interleaving_explorer::wait();
+                }
+            }
+            EXPECT_EQ(producers * items_per_producer, checker.received());
+        });
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
+
+TEST(test_stress, interleavings_mpsc_claim_commit)
+{
+    static constexpr size_t producers = 2;
+    using queue_type = waitfree::mpsc_queue<uint64_t, 8>;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        auto queue = std::make_shared<queue_type>();
+        auto done = std::make_shared<std::atomic<size_t>>(0);
+        interleaving_explorer::bodies bodies;
+        // The first producer claims a single slot and a batch, the second pushes a batch, so their reservations
+        // interleave in the ring.
+        bodies.emplace_back([queue, done]() {
+            auto* item = queue->claim(encode(0, 0));
+            interleaving_explorer::point();
+            queue->commit(item);
+            auto reservation = queue->claim_bulk(2);
+            reservation[0] = encode(0, 1);
+            reservation[1] = encode(0, 2);
+            interleaving_explorer::point();
+            queue->commit(reservation);
+            done->fetch_add(1);
+        });
+        bodies.emplace_back([queue, done]() {
+            const uint64_t items[] = {encode(1, 0), encode(1, 1)};
+            EXPECT_EQ(2u, queue->push_bulk(items, items + 2));
+            done->fetch_add(1);
+        });
+        bodies.emplace_back([queue, done]() {
+            order_checker checker(producers);
+            while (checker.received() < 5)
+            {
+                uint64_t items[4];
+                const auto count = queue->pop_bulk(items, 4);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    checker.check(items[i]);
+                }
+                if (count != 0)
+                {
+                    continue;
+                }
+                if (done->load() == producers && queue->empty())
+                {
+                    break;
+                }
+                interleaving_explorer::wait();
+            }
+            EXPECT_EQ(5u, checker.received());
+        });
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
+
+TEST(test_stress, interleavings_segmented_mpsc_queue)
+{
+    static constexpr size_t producers = 2;
+    static constexpr uint64_t items_per_producer = 3;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        // Two slot segments, so orders where a producer stops between loading the tail segment and claiming a slot
+        // while the consumer drains and recycles that segment are tried.
+        auto guarded = std::make_shared<guarded_segmented_queue<2>>();
+        auto done = std::make_shared<std::atomic<size_t>>(0);
+        interleaving_explorer::bodies bodies;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            bodies.emplace_back([guarded, done, p]() {
+                for (uint64_t i = 0; i < items_per_producer; ++i)
+                {
+                    guarded->queue->push(encode(p, i));
+                }
+                done->fetch_add(1);
+            });
+        }
+        bodies.emplace_back([guarded, done]() {
+            order_checker checker(producers);
+            uint64_t item;
+            while (checker.received() < producers * items_per_producer)
+            {
+                if (guarded->queue->pop(item))
+                {
+                    checker.check(item);
+                }
+                else if (done->load() == producers && guarded->queue->empty())
+                {
+                    break;
+                }
+                else
+                {
+                    interleaving_explorer::wait();
+                }
+            }
+            EXPECT_EQ(producers * items_per_producer, checker.received());
+        });
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
+
+TEST(test_stress, interleavings_spsc_publish_batch)
+{
+    static constexpr uint64_t items = 5;
+    using queue_type = waitfree::spsc_queue<uint64_t, 2>;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        auto queue = std::make_shared<queue_type>();
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        interleaving_explorer::bodies bodies;
+        bodies.emplace_back([queue, done]() {
+            queue->set_publish_batch(2);
+            for (uint64_t i = 0; i < items;)
+            {
+                if (queue->try_push(encode(0, i)))
+                {
+                    ++i;
+                }
+                else
+                {
+                    // A full queue with pending items has to be flushed, the consumer can not make room otherwise.
+                    queue->flush();
+                    interleaving_explorer::wait();
+                }
+            }
+            queue->flush();
+            done->store(true);
+        });
+        bodies.emplace_back([queue, done]() {
+            order_checker checker(1);
+            uint64_t item;
+            while (checker.received() < items)
+            {
+                if (queue->pop(item))
+                {
+                    checker.check(item);
+                }
+                else if (done->load() && queue->size() == 0)
+                {
+                    break;
+                }
+                else
+                {
+                    interleaving_explorer::wait();
+                }
+            }
+            EXPECT_EQ(items, checker.received());
+        });
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
+
+TEST(test_stress, interleavings_mpmc_push_pop)
+{
+    static constexpr size_t producers = 2;
+    static constexpr size_t consumers = 2;
+    static constexpr uint64_t items_per_producer = 2;
+    using queue_type = waitfree::mpmc_queue<uint64_t, 4>;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        auto queue = std::make_shared<queue_type>();
+        auto producers_done = std::make_shared<std::atomic<size_t>>(0);
+        auto consumers_done = std::make_shared<std::atomic<size_t>>(0);
+        auto received = std::make_shared<std::vector<uint64_t>>();
+        interleaving_explorer::bodies bodies;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            bodies.emplace_back([queue, producers_done, p]() {
+                for (uint64_t i = 0; i < items_per_producer; ++i)
+                {
+                    queue->push(encode(p, i));
+                }
+                producers_done->fetch_add(1);
+            });
+        }
+        for (size_t c = 0; c < consumers; ++c)
+        {
+            bodies.emplace_back([queue, producers_done, consumers_done, received]() {
+                uint64_t item;
+                while (received->size() < producers * items_per_producer)
+                {
+                    if (queue->pop(item))
+                    {
+                        // Only one thread runs at a time, the vector needs no lock.
+                        received->push_back(item);
+                    }
+                    else if (producers_done->load() == producers && queue->empty())
+                    {
+                        break;
+                    }
+                    else
+                    {
+                        interleaving_explorer::wait();
+                    }
+                }
+
+                if (consumers_done->fetch_add(1) + 1 == consumers)
+                {
+                    auto sorted = *received;
+                    std::sort(sorted.begin(), sorted.end());
+                    const std::vector<uint64_t> expected = {encode(0, 0), encode(0, 1), encode(1, 0), encode(1, 1)};
+                    EXPECT_EQ(expected, sorted);
+                }
+            });
+        }
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
+
+TEST(test_stress, interleavings_mpsc_byte_ring)
+{
+    static constexpr size_t producers = 2;
+    static constexpr uint64_t messages_per_producer = 2;
+    // Room for two 24 byte records, the second lap starts with padding in most orders.
+    using ring_type = waitfree::mpsc_byte_ring<64>;
+    interleaving_explorer explorer(preemption_bound);
+    const auto runs = explorer.explore([]() {
+        auto ring = std::make_shared<ring_type>();
+        auto done = std::make_shared<std::atomic<size_t>>(0);
+        interleaving_explorer::bodies bodies;
+        for (size_t p = 0; p < producers; ++p)
+        {
+            bodies.emplace_back([ring, done, p]() {
+                for (uint64_t s = 0; s < messages_per_producer;)
+                {
+                    const uint64_t message[2] = {encode(p, s), s};
+                    if (ring->push(message, sizeof(message) - p * sizeof(uint64_t)))
+                    {
+                        ++s;
+                    }
+                    else
+                    {
+                        interleaving_explorer::wait();
+                    }
+                }
+                done->fetch_add(1);
+            });
+        }
+        bodies.emplace_back([ring, done]() {
+            order_checker checker(producers);
+            while (checker.received() < producers * messages_per_producer)
+            {
+                const auto message = ring->read();
+                if (message.empty())
+                {
+                    if (done->load() == producers && ring->empty())
+                    {
+                        break;
+                    }
+                    interleaving_explorer::wait();
+                    continue;
+                }
+                uint64_t header;
+                std::memcpy(&header, message.data(), sizeof(header));
+                EXPECT_EQ((header >> 32) == 0 ? 16u : 8u, message.size());
+                checker.check(header);
+                ring->release();
+            }
+            EXPECT_EQ(producers * messages_per_producer, checker.received());
+        });
+        return bodies;
+    });
+    EXPECT_GT(runs, 1u);
+}
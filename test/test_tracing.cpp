@@ -0,0 +1,120 @@
+#include "mpsc_queue.h"
+#include "tracing.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <thread>
+
+TEST(test_tracing, timestamp)
+{
+    const auto first = waitfree::read_timestamp();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    const auto second = waitfree::read_timestamp();
+    EXPECT_GT(second, first);
+    EXPECT_GT(waitfree::timestamp_frequency(), 0u);
+    EXPECT_GE(waitfree::timestamp_to_duration(second - first), std::chrono::milliseconds(1));
+}
+
+TEST(test_tracing, timestamp_uses_padding)
+{
+    EXPECT_EQ(sizeof(waitfree::padded_layout::element<uint64_t>), sizeof(waitfree::timestamped_layout::element<uint64_t>));
+    EXPECT_FALSE(waitfree::detail::has_timestamp_v<waitfree::padded_layout::element<uint64_t>>);
+    EXPECT_TRUE(waitfree::detail::has_timestamp_v<waitfree::timestamped_layout::element<uint64_t>>);
+}
+
+TEST(test_tracing, pop_sojourn)
+{
+    auto queue = std::make_unique<waitfree::mpsc_queue<uint64_t, 16, waitfree::timestamped_layout>>();
+
+    uint64_t result;
+    uint64_t sojourn = 0;
+    EXPECT_FALSE(queue->pop(result, sojourn));
+
+    queue->push(uint64_t(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    EXPECT_TRUE(queue->pop(result, sojourn));
+    EXPECT_EQ(1u, result);
+    EXPECT_GE(waitfree::timestamp_to_duration(sojourn), std::chrono::milliseconds(1));
+
+    // Claimed items are stamped when committed.
+    auto item = queue->claim(uint64_t(2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    queue->commit(item);
+    EXPECT_TRUE(queue->pop(result, sojourn));
+    EXPECT_EQ(2u, result);
+    EXPECT_LT(waitfree::timestamp_to_duration(sojourn), std::chrono::milliseconds(2));
+
+    const uint64_t values[] = {3, 4, 5};
+    EXPECT_EQ(3u, queue->push_bulk(std::begin(values), std::end(values)));
+    EXPECT_TRUE(queue->try_push(uint64_t(6)));
+    for (uint64_t i = 3; i <= 6; ++i)
+    {
+        EXPECT_TRUE(queue->pop(result, sojourn));
+        EXPECT_EQ(i, result);
+    }
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(test_tracing, trace_ring_sampling)
+{
+    waitfree::trace_ring<16, 4> trace;
+    waitfree::trace_record records[32];
+    EXPECT_EQ(0u, trace.read(records, 32));
+
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        trace.add(i, i * 2);
+    }
+    EXPECT_EQ(250u, trace.size());
+
+    EXPECT_EQ(16u, trace.read(records, 32));
+    for (size_t i = 0; i < 16; ++i)
+    {
+        const uint64_t expected = (250 - 16 + i) * 4;
+        EXPECT_EQ(expected, records[i].dequeued);
+        EXPECT_EQ(expected * 2, records[i].sojourn);
+    }
+
+    EXPECT_EQ(4u, trace.read(records, 4));
+    EXPECT_EQ(996u, records[3].dequeued);
+}
+
+TEST(test_tracing, trace_ring_concurrent_read)
+{
+    static constexpr uint64_t num_samples = 200000;
+    auto trace = std::make_unique<waitfree::trace_ring<64, 1>>();
+    std::atomic<bool> done{false};
+
+    std::thread reader([&trace, &done]() {
+        waitfree::trace_record records[64];
+        while (!done.load(std::memory_order_acquire))
+        {
+            const auto count = trace->read(records, 64);
+            for (size_t i = 0; i < count; ++i)
+            {
+                ASSERT_EQ(records[i].dequeued * 2, records[i].sojourn);
+                if (i != 0)
+                {
+                    ASSERT_LT(records[i - 1].dequeued, records[i].dequeued);
+                }
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    for (uint64_t i = 0; i < num_samples; ++i)
+    {
+        trace->add(i, i * 2);
+        if ((i & 1023) == 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    EXPECT_EQ(num_samples, trace->size());
+}
@@ -0,0 +1,104 @@
+#include "mpsc_queue.h"
+#include "spsc_queue.h"
+#include "spsc_queue_fast.h"
+#include "wait_strategy.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace
+{
+
+constexpr size_t num_elements = 16384;
+
+template<typename Q>
+void pop_wait_timeout()
+{
+    auto queue = std::make_unique<Q>();
+
+    uint64_t result;
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(queue->pop_wait(result, std::chrono::milliseconds(20)));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    queue->push(uint64_t(1));
+    EXPECT_TRUE(queue->pop_wait(result, std::chrono::milliseconds(20)));
+    EXPECT_EQ(1, result);
+}
+
+template<typename Q>
+void pop_wait_multi_thread()
+{
+    auto queue = std::make_unique<Q>();
+
+    auto producer = std::make_unique<std::thread>([&queue]() {
+        for (uint64_t i = 0; i < num_elements; ++i)
+        {
+            queue->push(i);
+            if (i % 1024 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        uint64_t result;
+        ASSERT_TRUE(queue->pop_wait(result, std::chrono::seconds(10)));
+        EXPECT_EQ(i, result);
+    }
+
+    producer->join();
+}
+
+}// namespace
+
+TEST(test_wait_strategy, spin_wait)
+{
+    pop_wait_timeout<waitfree::mpsc_queue<uint64_t, num_elements>>();
+    pop_wait_timeout<waitfree::spsc_queue<uint64_t, num_elements>>();
+    pop_wait_timeout<waitfree::spsc_queue_fast<uint64_t, num_elements>>();
+}
+
+TEST(test_wait_strategy, yield_wait)
+{
+    using wait = waitfree::yield_wait<>;
+    pop_wait_timeout<waitfree::mpsc_queue<uint64_t, num_elements, waitfree::padded_layout, waitfree::default_allocator, wait>>();
+    pop_wait_timeout<waitfree::spsc_queue<uint64_t, num_elements, waitfree::default_allocator, wait>>();
+    pop_wait_multi_thread<waitfree::mpsc_queue<uint64_t, num_elements, waitfree::padded_layout, waitfree::default_allocator, wait>>();
+    pop_wait_multi_thread<waitfree::spsc_queue_fast<uint64_t, num_elements, waitfree::default_allocator, wait>>();
+}
+
+TEST(test_wait_strategy, park_wait)
+{
+    using wait = waitfree::park_wait<>;
+    pop_wait_timeout<waitfree::mpsc_queue<uint64_t, num_elements, waitfree::packed_layout, waitfree::default_allocator, wait>>();
+    pop_wait_timeout<waitfree::spsc_queue<uint64_t, num_elements, waitfree::default_allocator, wait>>();
+    pop_wait_timeout<waitfree::spsc_queue_fast<uint64_t, num_elements, waitfree::default_allocator, wait>>();
+    pop_wait_multi_thread<waitfree::mpsc_queue<uint64_t, num_elements, waitfree::packed_layout, waitfree::default_allocator, wait>>();
+    pop_wait_multi_thread<waitfree::spsc_queue<uint64_t, num_elements, waitfree::default_allocator, wait>>();
+    pop_wait_multi_thread<waitfree::spsc_queue_fast<uint64_t, num_elements, waitfree::default_allocator, wait>>();
+}
+
+TEST(test_wait_strategy, park_wait_wakes_parked_consumer)
+{
+    using queue_type = waitfree::spsc_queue_fast<uint64_t, 16, waitfree::default_allocator, waitfree::park_wait<0, 0>>;
+    auto queue = std::make_unique<queue_type>();
+
+    auto producer = std::make_unique<std::thread>([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        queue->push(uint64_t(7));
+    });
+
+    uint64_t result;
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(queue->pop_wait(result, std::chrono::seconds(10)));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_EQ(7, result);
+
+    producer->join();
+}
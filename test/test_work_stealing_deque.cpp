@@ -0,0 +1,152 @@
+#include "work_stealing_deque.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t num_elements = 65536;
+
+}// namespace
+
+TEST(test_work_stealing_deque, push_pop_is_lifo)
+{
+    auto deque = std::make_unique<waitfree::work_stealing_deque<uint64_t, 16>>();
+    EXPECT_TRUE(deque->empty());
+
+    for (uint64_t i = 0; i < 16; ++i)
+    {
+        deque->push(i);
+    }
+    EXPECT_EQ(16u, deque->size());
+
+    for (uint64_t i = 16; i > 0; --i)
+    {
+        uint64_t result;
+        ASSERT_TRUE(deque->pop(result));
+        EXPECT_EQ(i - 1, result);
+    }
+    EXPECT_TRUE(deque->empty());
+
+    uint64_t result;
+    EXPECT_FALSE(deque->pop(result));
+    EXPECT_TRUE(deque->empty());
+}
+
+TEST(test_work_stealing_deque, steal_is_fifo)
+{
+    auto deque = std::make_unique<waitfree::work_stealing_deque<uint64_t, 16>>();
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        deque->push(i);
+    }
+
+    uint64_t result;
+    EXPECT_TRUE(deque->steal(result));
+    EXPECT_EQ(0u, result);
+    EXPECT_TRUE(deque->steal(result));
+    EXPECT_EQ(1u, result);
+    EXPECT_TRUE(deque->pop(result));
+    EXPECT_EQ(7u, result);
+    EXPECT_EQ(5u, deque->size());
+}
+
+TEST(test_work_stealing_deque, try_push_full)
+{
+    auto deque = std::make_unique<waitfree::work_stealing_deque<uint64_t, 4>>();
+
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(deque->try_push(i));
+    }
+    EXPECT_FALSE(deque->try_push(4));
+
+    uint64_t result;
+    EXPECT_TRUE(deque->steal(result));
+    EXPECT_EQ(0u, result);
+    EXPECT_TRUE(deque->try_push(4));
+    EXPECT_FALSE(deque->try_push(5));
+
+    for (uint64_t i = 5; i > 1; --i)
+    {
+        EXPECT_TRUE(deque->pop(result));
+        EXPECT_EQ(i - 1, result);
+    }
+}
+
+TEST(test_work_stealing_deque, multi_thread_push_pop_steal_correctness)
+{
+    static constexpr size_t num_thieves = 2;
+    auto deque = std::make_unique<waitfree::work_stealing_deque<uint64_t, 1024>>();
+
+    std::atomic<bool> done{false};
+    std::vector<std::vector<uint64_t>> stolen(num_thieves);
+    std::vector<std::unique_ptr<std::thread>> thieves;
+    for (size_t thread_id = 0; thread_id < num_thieves; ++thread_id)
+    {
+        thieves.emplace_back(std::make_unique<std::thread>([&deque, &done, &stolen, thread_id]() {
+            for (;;)
+            {
+                uint64_t result;
+                if (deque->steal(result))
+                {
+                    stolen[thread_id].push_back(result);
+                    continue;
+                }
+                if (done.load(std::memory_order_acquire) && deque->empty())
+                {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }));
+    }
+
+    std::vector<uint64_t> popped;
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        while (!deque->try_push(i))
+        {
+            std::this_thread::yield();
+        }
+        if ((i & 3) == 0)
+        {
+            uint64_t result;
+            if (deque->pop(result))
+            {
+                popped.push_back(result);
+            }
+        }
+    }
+    done.store(true, std::memory_order_release);
+
+    for (auto& thread : thieves)
+    {
+        thread->join();
+    }
+
+    std::vector<bool> seen(num_elements, false);
+    const auto check = [&seen](const std::vector<uint64_t>& values) {
+        for (const auto value : values)
+        {
+            ASSERT_LT(value, num_elements);
+            EXPECT_FALSE(seen[value]);
+            seen[value] = true;
+        }
+    };
+    check(popped);
+    for (const auto& values : stolen)
+    {
+        check(values);
+    }
+    for (uint64_t i = 0; i < num_elements; ++i)
+    {
+        EXPECT_TRUE(seen[i]);
+    }
+}
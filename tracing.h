@@ -0,0 +1,240 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "cache_line.h"
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+namespace waitfree
+{
+
+/**
+ * @brief Reads a cheap, monotonic timestamp counter.
+ *
+ * @details
+ * rdtsc on x86, cntvct_el0 on arm64 and the steady clock in nanoseconds elsewhere. The counter is not serializing,
+ * loads and stores around it may be reordered across the read, which is fine for queue sojourn times. The x86 time
+ * stamp counter is assumed to be invariant and synchronized between cores, as it is on current processors.
+ */
+inline uint64_t read_timestamp() noexcept
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/**
+ * @brief Get the number of read_timestamp() ticks per second.
+ *
+ * @details
+ * Read from cntfrq_el0 on arm64. On x86 the first call calibrates the counter against the steady clock, which blocks
+ * the caller for about 10 ms, so call it once up front rather than from a latency sensitive thread.
+ */
+inline uint64_t timestamp_frequency() noexcept
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    static const uint64_t frequency = []() {
+        const auto start_time = std::chrono::steady_clock::now();
+        const auto start_ticks = read_timestamp();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const auto ticks = read_timestamp() - start_ticks;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time);
+        return static_cast<uint64_t>(static_cast<double>(ticks) * 1e9 / static_cast<double>(elapsed.count()));
+    }();
+    return frequency;
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+    uint64_t value;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(value));
+    return value;
+#else
+    return 1000000000;
+#endif
+}
+
+/**
+ * @brief Converts a number of read_timestamp() ticks to nanoseconds.
+ */
+inline std::chrono::nanoseconds timestamp_to_duration(const uint64_t ticks) noexcept
+{
+    return std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(ticks) * 1e9 / static_cast<double>(timestamp_frequency())));
+}
+
+namespace detail
+{
+
+template<typename Element, typename = void>
+struct has_timestamp : std::false_type
+{
+};
+
+template<typename Element>
+struct has_timestamp<Element, std::void_t<decltype(std::declval<Element&>().timestamp_)>> : std::true_type
+{
+};
+
+/**
+ * True when the slots of a queue carry an enqueue timestamp, see timestamped_layout in mpsc_queue.h.
+ */
+template<typename Element>
+inline constexpr bool has_timestamp_v = has_timestamp<Element>::value;
+
+/**
+ * Ticks from enqueued to dequeued, 0 if the counters of the two cores disagree on the order.
+ */
+inline uint64_t elapsed_ticks(const uint64_t enqueued, const uint64_t dequeued) noexcept
+{
+    return dequeued > enqueued ? dequeued - enqueued : 0;
+}
+
+}// namespace detail
+
+/**
+ * A sampled sojourn time, both values in read_timestamp() ticks.
+ */
+struct trace_record
+{
+    uint64_t dequeued = 0;
+    uint64_t sojourn = 0;
+};
+
+/**
+ * Lock-free ring of sampled sojourn times for export.
+ *
+ * The consumer of a queue passes every sojourn time to add(), which keeps one in SampleEvery and overwrites the
+ * oldest record when the ring is full. Any thread can copy out the most recent records with read() while the
+ * consumer keeps adding, records being overwritten during the copy are skipped.
+ *
+ * N is the number of records kept and SampleEvery the sampling interval, both powers of 2.
+ */
+template<size_t N = 1024, size_t SampleEvery = 64>
+class trace_ring
+{
+public:
+    trace_ring() noexcept
+    {
+        static_assert(N != 0 && (N & (N - 1)) == 0);
+        static_assert(SampleEvery != 0 && (SampleEvery & (SampleEvery - 1)) == 0);
+    }
+
+    /**
+     * @brief Samples a sojourn time that ended at dequeued.
+     *
+     * Not thread safe with regards to other add operations, thread safe with regards to read operations.
+   */
+    void add(const uint64_t dequeued, const uint64_t sojourn) noexcept
+    {
+        const auto count = count_++;
+        if ((count & (SampleEvery - 1)) != 0)
+        {
+            return;
+        }
+
+        const auto position = written_.load(std::memory_order_relaxed);
+        auto& record = records_[position & (N - 1)];
+        // Odd while the record is written, readers retry or skip it.
+        record.version_.store(position * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        record.dequeued_.store(dequeued, std::memory_order_relaxed);
+        record.sojourn_.store(sojourn, std::memory_order_relaxed);
+        record.version_.store(position * 2 + 2, std::memory_order_release);
+        written_.store(position + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Copies up to max of the most recent records to out, oldest first.
+     *
+     * @details
+     * Returns the number of records written to out.
+     *
+     * Thread safe with regards to all operations.
+   */
+    size_t read(trace_record* out, const size_t max) const noexcept
+    {
+        const auto written = written_.load(std::memory_order_acquire);
+        const auto available = static_cast<uint64_t>(std::min<uint64_t>(written, std::min<uint64_t>(N, max)));
+        size_t count = 0;
+        for (auto position = written - available; position != written; ++position)
+        {
+            const auto& record = records_[position & (N - 1)];
+            const auto version = record.version_.load(std::memory_order_acquire);
+            trace_record result;
+            result.dequeued = record.dequeued_.load(std::memory_order_relaxed);
+            result.sojourn = record.sojourn_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version != position * 2 + 2 || record.version_.load(std::memory_order_relaxed) != version)
+            {
+                continue;
+            }
+            out[count++] = result;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Get the number of records added since construction, including overwritten ones.
+     *
+     * Thread safe with regards to all operations.
+   */
+    [[nodiscard]] uint64_t size() const noexcept
+    {
+        return written_.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+
+    struct record
+    {
+        std::atomic<uint64_t> version_{0};
+        std::atomic<uint64_t> dequeued_{0};
+        std::atomic<uint64_t> sojourn_{0};
+    };
+
+    // Only accessed by the consumer.
+    uint64_t count_ = 0;
+    alignas(cache_line_size_) std::atomic<uint64_t> written_{0};
+    alignas(cache_line_size_) record records_[N];
+};
+
+}// namespace waitfree
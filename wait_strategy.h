@@ -0,0 +1,280 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "cache_line.h"
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#define WAITFREE_WAIT_STRATEGY_UNDEF_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define WAITFREE_WAIT_STRATEGY_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef WAITFREE_WAIT_STRATEGY_UNDEF_NOMINMAX
+#undef NOMINMAX
+#undef WAITFREE_WAIT_STRATEGY_UNDEF_NOMINMAX
+#endif
+#ifdef WAITFREE_WAIT_STRATEGY_UNDEF_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef WAITFREE_WAIT_STRATEGY_UNDEF_WIN32_LEAN_AND_MEAN
+#endif
+#ifdef _MSC_VER
+#pragma comment(lib, "Synchronization.lib")
+#endif
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__APPLE__)
+// Used by libc++ to implement std::atomic::wait, declared here since there is no public header.
+extern "C" int __ulock_wait(uint32_t operation, void* address, uint64_t value, uint32_t timeout_us);
+extern "C" int __ulock_wake(uint32_t operation, void* address, uint64_t wake_value);
+#endif
+
+namespace waitfree
+{
+
+/**
+ * Wait strategies decide what a consumer does in pop_wait() while the queue is empty.
+ *
+ * A wait strategy provides
+ *     void notify() noexcept;
+ *     template<typename Ready> bool wait_until(Ready&& ready, std::chrono::steady_clock::time_point deadline) noexcept;
+ * notify() is called by producers after every publish and must be cheap. wait_until() returns true once ready()
+ * returns true, or false if the deadline passes first. Only one thread may wait at a time, which the single consumer
+ * queues guarantee.
+ */
+
+namespace detail
+{
+
+inline void cpu_relax() noexcept
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(_M_ARM64)
+    __yield();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * Blocks while *address == expected or until timeout passes. May return spuriously.
+ */
+inline void wait_on_address(std::atomic<uint32_t>& address, const uint32_t expected, const std::chrono::nanoseconds timeout) noexcept
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+    if (timeout.count() <= 0)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    auto expected_value = expected;
+    const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count() + 1;
+    WaitOnAddress(&address, &expected_value, sizeof(expected_value), milliseconds >= INFINITE ? INFINITE - 1 : static_cast<DWORD>(milliseconds));
+#elif defined(__linux__)
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec relative;
+    relative.tv_sec = static_cast<time_t>(seconds.count());
+    relative.tv_nsec = static_cast<long>((timeout - seconds).count());
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&address), FUTEX_WAIT_PRIVATE, expected, &relative, nullptr, 0);
+#elif defined(__APPLE__)
+    constexpr uint32_t ul_compare_and_wait = 1;
+    const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(timeout).count() + 1;
+    __ulock_wait(ul_compare_and_wait, &address, expected, microseconds >= UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(microseconds));
+#else
+    (void) expected;
+    std::this_thread::sleep_for(std::min(timeout, std::chrono::nanoseconds(std::chrono::microseconds(50))));
+#endif
+}
+
+inline void wake_address(std::atomic<uint32_t>& address) noexcept
+{
+#if defined(_WIN32)
+    WakeByAddressAll(&address);
+#elif defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&address), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#elif defined(__APPLE__)
+    constexpr uint32_t ul_compare_and_wait = 1;
+    constexpr uint32_t ulf_wake_all = 0x100;
+    __ulock_wake(ul_compare_and_wait | ulf_wake_all, &address, 0);
+#else
+    (void) address;
+#endif
+}
+
+}// namespace detail
+
+/**
+ * Busy spins on the queue. notify() is a no-op, so producers pay nothing. This is the default.
+ */
+struct spin_wait
+{
+    void notify() noexcept
+    {
+    }
+
+    template<typename Ready>
+    bool wait_until(Ready&& ready, const std::chrono::steady_clock::time_point deadline) noexcept
+    {
+        for (;;)
+        {
+            for (size_t i = 0; i < clock_check_interval_; ++i)
+            {
+                if (ready())
+                {
+                    return true;
+                }
+            }
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return ready();
+            }
+        }
+    }
+
+    static constexpr size_t clock_check_interval_ = 256;
+};
+
+/**
+ * Spins with a pause instruction for Spins iterations, then yields the thread between checks. notify() is a no-op.
+ */
+template<size_t Spins = 1024>
+struct yield_wait
+{
+    void notify() noexcept
+    {
+    }
+
+    template<typename Ready>
+    bool wait_until(Ready&& ready, const std::chrono::steady_clock::time_point deadline) noexcept
+    {
+        for (size_t i = 0; i < Spins; ++i)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            detail::cpu_relax();
+        }
+
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        return ready();
+    }
+};
+
+/**
+ * Spins with a pause instruction, then yields, and finally parks the consumer on a futex (Linux), WaitOnAddress
+ * (Windows) or __ulock_wait (macOS).
+ *
+ * Producers only make a system call when the consumer has announced that it is parked. notify() costs a full memory
+ * fence and a load of a line that is only written when the consumer parks, which orders the producer's publish
+ * before the check of the parked flag so that wakeups are never lost.
+ */
+template<size_t Spins = 1024, size_t Yields = 64>
+struct park_wait
+{
+    void notify() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) != 0)
+        {
+            epoch_.fetch_add(1, std::memory_order_release);
+            detail::wake_address(epoch_);
+        }
+    }
+
+    template<typename Ready>
+    bool wait_until(Ready&& ready, const std::chrono::steady_clock::time_point deadline) noexcept
+    {
+        for (size_t i = 0; i < Spins; ++i)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            detail::cpu_relax();
+        }
+
+        for (size_t i = 0; i < Yields; ++i)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        for (;;)
+        {
+            const auto epoch = epoch_.load(std::memory_order_acquire);
+            sleeping_.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready())
+            {
+                sleeping_.store(0, std::memory_order_relaxed);
+                return true;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                sleeping_.store(0, std::memory_order_relaxed);
+                return false;
+            }
+            detail::wait_on_address(epoch_, epoch, deadline - now);
+            sleeping_.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    alignas(cache_line_size) std::atomic<uint32_t> sleeping_{0};
+    std::atomic<uint32_t> epoch_{0};
+};
+
+}// namespace waitfree
@@ -0,0 +1,255 @@
+/*
+MIT License
+
+Copyright (c) 2024 Marcus Spangenberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "allocator.h"
+#include "cache_line.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace waitfree
+{
+
+/**
+ * Bounded Chase-Lev work-stealing deque.
+ *
+ * The owner thread pushes and pops at the bottom, any number of thief threads steal from the top. The owner only
+ * synchronizes with thieves when the deque holds a single item, so push and pop cost about as much as on a
+ * spsc_queue. The memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê et al.
+ *
+ * A thief reads the item before it knows if its steal succeeds, so items are stored in std::atomic<T>. T must be
+ * trivially copyable and is meant to be small, typically a pointer to a task.
+ *
+ * T is the type of the elements in the deque.
+ * S is the maximum number of elements in the deque. S must be a power of 2.
+ * Allocator allocates the element buffer, see allocator.h.
+ */
+template<typename T, size_t S, typename Allocator = default_allocator>
+class work_stealing_deque
+{
+    using element = std::atomic<T>;
+
+public:
+    work_stealing_deque()
+        : work_stealing_deque(Allocator())
+    {
+    }
+
+    /**
+     * Constructs a deque that allocates its buffer from allocator.
+     */
+    explicit work_stealing_deque(const Allocator& allocator)
+        : allocator_(allocator),
+          top_(0),
+          bottom_(0)
+    {
+        static_assert(is_power_of_two(S) && S != 0);
+        static_assert(std::is_trivially_copyable_v<T>, "work_stealing_deque requires a trivially copyable T");
+
+        auto alloc_result = allocator_.allocate(allocation_size_, alignment_);
+        if (!alloc_result)
+        {
+            throw std::bad_alloc();
+        }
+        elements_ = reinterpret_cast<element*>(alloc_result);
+        for (size_t i = 0; i < S; ++i)
+        {
+            new (&elements_[i]) element();
+        }
+    }
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    ~work_stealing_deque()
+    {
+        allocator_.deallocate(elements_, allocation_size_, alignment_);
+    }
+
+    /**
+     * @brief Pushes an item to the bottom of the deque.
+     *
+     * @details
+     * Will assert if the deque is full if asserts are enabled,
+     * otherwise the behaviour is undefined. The deque should be dimensioned so that this never happens.
+     *
+     * Only to be called by the owner thread. Thread safe with regards to steal operations.
+   */
+    void push(const T& item) noexcept
+    {
+        const auto bottom = bottom_.load(std::memory_order_relaxed);
+        assert(bottom - top_.load(std::memory_order_acquire) < static_cast<int64_t>(S));
+        elements_[bottom & mod_value_].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Tries to push an item to the bottom of the deque.
+     *
+     * @details
+     * Returns false without modifying the deque if the deque is full, otherwise pushes the item and returns true.
+     *
+     * Only to be called by the owner thread. Thread safe with regards to steal operations.
+   */
+    bool try_push(const T& item) noexcept
+    {
+        const auto bottom = bottom_.load(std::memory_order_relaxed);
+        if (bottom - top_.load(std::memory_order_acquire) >= static_cast<int64_t>(S))
+        {
+            return false;
+        }
+        elements_[bottom & mod_value_].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Pops the most recently pushed item from the bottom of the deque.
+     *
+     * @details
+     * Returns false if the deque is empty or the last item was stolen concurrently, otherwise true. item is only
+     * valid if the function returns true.
+     *
+     * Only to be called by the owner thread. Thread safe with regards to steal operations.
+   */
+    bool pop(T& item) noexcept
+    {
+        const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = top_.load(std::memory_order_relaxed);
+        if (top > bottom)
+        {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto value = elements_[bottom & mod_value_].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // Last item, race the thieves for it.
+            const auto won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            if (!won)
+            {
+                return false;
+            }
+        }
+        item = value;
+        return true;
+    }
+
+    /**
+     * @brief Steals the least recently pushed item from the top of the deque.
+     *
+     * @details
+     * Returns false if the deque is empty or another thread took the item first, otherwise true. item is only
+     * valid if the function returns true.
+     *
+     * Thread safe with regards to other steal operations and to the owner's push and pop operations.
+   */
+    bool steal(T& item) noexcept
+    {
+        auto top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return false;
+        }
+
+        const auto value = elements_[top & mod_value_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return false;
+        }
+        item = value;
+        return true;
+    }
+
+    /**
+     * @brief Checks if the deque is empty
+     *
+     * @details
+     * The result is a snapshot when the deque is concurrently modified.
+     *
+     * Thread safe with regards to push, pop and steal operations.
+   */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Get the number of elements in the deque.
+     *
+     * @details
+     * The result is a snapshot when the deque is concurrently modified.
+     *
+     * Thread safe with regards to push, pop and steal operations.
+   */
+    [[nodiscard]] size_t size() const noexcept
+    {
+        const auto top = top_.load(std::memory_order_acquire);
+        const auto bottom = bottom_.load(std::memory_order_acquire);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    /**
+     * @brief Get the maximum number of elements in the deque.
+   */
+    [[nodiscard]] static constexpr size_t capacity() noexcept
+    {
+        return S;
+    }
+
+private:
+    static constexpr size_t cache_line_size_ = cache_line_size;
+    static constexpr int64_t mod_value_ = static_cast<int64_t>(S - 1);
+    static constexpr size_t alignment_ = std::max(alignof(element), sizeof(void*));
+    static constexpr size_t allocation_size_ = (sizeof(element) * S + alignment_ - 1) / alignment_ * alignment_;
+
+    element* elements_;
+    Allocator allocator_;
+    // Written by thieves and, for the last item, by the owner.
+    alignas(cache_line_size_) std::atomic<int64_t> top_;
+    // Only written by the owner.
+    alignas(cache_line_size_) std::atomic<int64_t> bottom_;
+
+    static constexpr bool is_power_of_two(const size_t size)
+    {
+        return (size & (size - 1)) == 0;
+    }
+};
+
+}// namespace waitfree